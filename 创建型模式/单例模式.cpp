@@ -29,7 +29,7 @@ public:
     void show(){
         for (const auto& ele:this->goodsOrder){
             //当elements[ele]为0（即不存在ele）时，使用at可抛出异常，更符合实际应用
-            cout<<ele<<" "<<elements.at(ele)<<endl;
+            cout<<ele<<" "<<elements.at(ele)<<'\n';
         }
     }
 
@@ -43,6 +43,8 @@ public:
 
 
 int main() {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
     string itemName;
     int quantity;
     CartManager& cartManager=CartManager::getInstance();
@@ -45,6 +45,8 @@ public:
 
 
 int main() {
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(nullptr);
     std::string color;
     int width;
     int height;
@@ -54,7 +56,7 @@ int main() {
     Prototype *prototype = new Rectangle(color, width, height);
     for (int i = 0; i < N; ++i) {
         Prototype* clonedRectangle = prototype->clone();
-        std::cout<<clonedRectangle->getDetails()<<std::endl;
+        std::cout<<clonedRectangle->getDetails()<<'\n';
         delete clonedRectangle;
     }
     delete prototype;
@@ -24,14 +24,14 @@ public:
 class Circle:public Prodcut{
 public:
     void show() override{
-        std::cout<<"Circle Block"<<std::endl;
+        std::cout<<"Circle Block"<<'\n';
     }
 };
 
 class Square:public Prodcut{
 public:
     void show() override{
-        std::cout<<"Square Block"<<std::endl;
+        std::cout<<"Square Block"<<'\n';
     }
 };
 
@@ -59,6 +59,8 @@ public:
 
 
 int main(){
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(nullptr);
     int N;
     std::cin>>N;
     for (int i = 0; i < N; ++i) {
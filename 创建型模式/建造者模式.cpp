@@ -74,6 +74,8 @@ public:
 };
 
 int main(){
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(nullptr);
     int N;
     std::cin>>N;
     for (int i = 0; i < N; ++i) {
@@ -86,7 +88,7 @@ int main(){
             builder = new RoadBuilder();
         }
         Bike bike=Director::construct(*builder);
-        std::cout<<bike<<std::endl;
+        std::cout<<bike<<'\n';
         delete builder;
     }
     return 0;
@@ -25,26 +25,26 @@ public:
 class ModernSofa:public Sofa{
 public:
     void showSofa() override{
-        std::cout<<"modern sofa"<<std::endl;
+        std::cout<<"modern sofa"<<'\n';
     }
 };
 class ClassicalSofa:public Sofa{
 public:
     void showSofa() override{
-        std::cout<<"classical sofa"<<std::endl;
+        std::cout<<"classical sofa"<<'\n';
     }
 };
 
 class ModernChair:public Chair{
 public:
     void showChair() override{
-        std::cout<<"modern chair"<<std::endl;
+        std::cout<<"modern chair"<<'\n';
     }
 };
 class ClassicalChair:public Chair{
 public:
     void showChair() override{
-        std::cout<<"classical chair"<<std::endl;
+        std::cout<<"classical chair"<<'\n';
     }
 };
 
@@ -76,6 +76,8 @@ public:
 };
 
 int main(){
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(nullptr);
     int N;
     std::cin>>N;
     Factory* factory;
@@ -87,6 +89,8 @@ int main(){
         }else if (type=="classical"){
             factory=new ClassicalFactory();
         }else{
+            //异常未被捕获时程序直接终止，不会刷新cout的缓冲区，抛出前先把已有输出写出
+            std::cout.flush();
             throw std::invalid_argument("Invalid furniture type: "+type);
         }
         Chair* chair= factory->createChair();
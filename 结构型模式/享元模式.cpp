@@ -85,7 +85,7 @@ public:
 
     void draw(const Position &position) override {
         cout << shapeToString(this->shapeType) << " "<<
-        (this->isCreated ? "drawn" : "shared") << " at " << position << endl;
+        (this->isCreated ? "drawn" : "shared") << " at " << position << '\n';
     }
 
     void setCreated(bool firstTime) {
@@ -114,6 +114,8 @@ public:
 
 
 int main() {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
     string command;
     ShapeFactory factory;
     while (getline(cin, command)) {
@@ -130,6 +132,7 @@ int main() {
             type = TRIANGLE;
         } else {
             cerr << "Invalid shape type: " << typeStr << endl;
+            //exit()会正常析构标准流，cout中已缓冲的输出不会丢失
             exit(0);
         }
 
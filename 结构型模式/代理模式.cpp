@@ -22,7 +22,7 @@ public:
 class HouseBuyer : public HousePurchase {
 public:
     void requestHouse(int area) override {
-        std::cout << "YES" << std::endl;
+        std::cout << "YES" << '\n';
     }
 };
 
@@ -35,13 +35,15 @@ public:
         if (area > 100) {
             client.requestHouse(area);
         } else {
-            std::cout << "NO" << std::endl;
+            std::cout << "NO" << '\n';
         }
     }
 
 };
 
 int main() {
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(nullptr);
     int N;
     std::cin >> N;
     HouseBuyer client;
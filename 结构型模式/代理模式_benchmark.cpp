@@ -0,0 +1,69 @@
+/* 代理模式的标准输入输出基准：用同一份生成的输入分别以改动前后的IO方式运行main中的读写循环。
+ * before：cin/cout保持与C标准IO同步、cin绑定cout，每行输出后刷新（等同原来的endl）。
+ * after：sync_with_stdio(false)、cin.tie(nullptr)，输出只在缓冲区满或退出时写出。
+ * sync_with_stdio必须在任何IO之前调用，所以每种方式单独运行一个进程。输出写到/dev/null，耗时打印到stderr。
+ * 编译：g++ -std=c++17 -O2 代理模式_benchmark.cpp
+ * 用法：代理模式_benchmark before|after [请求数，默认1e6]
+ */
+//复用模式程序中的类，程序自己的main改名后不使用
+#define main proxyProgramMain
+#include "代理模式.cpp"
+#undef main
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    std::string mode = argc > 1 ? argv[1] : "";
+    long long requests = argc > 2 ? std::atoll(argv[2]) : 1000000;
+    if ((mode != "before" && mode != "after") || requests <= 0) {
+        std::fprintf(stderr, "usage: 代理模式_benchmark before|after [requests]\n");
+        return 2;
+    }
+
+    //生成输入文件，再把它接到标准输入上
+    const char* inputPath = "/tmp/代理模式_benchmark.in";
+    FILE* input = std::fopen(inputPath, "w");
+    if (input == nullptr) {
+        std::fprintf(stderr, "cannot write %s\n", inputPath);
+        return 1;
+    }
+    std::mt19937 rng(1);
+    std::fprintf(input, "%lld\n", requests);
+    for (long long i = 0; i < requests; ++i) {
+        std::fprintf(input, "%u\n", static_cast<unsigned>(rng() % 200));
+    }
+    std::fclose(input);
+    if (std::freopen(inputPath, "r", stdin) == nullptr || std::freopen("/dev/null", "w", stdout) == nullptr) {
+        std::fprintf(stderr, "cannot redirect standard streams\n");
+        return 1;
+    }
+
+    bool buffered = mode == "after";
+    auto start = std::chrono::steady_clock::now();
+    if (buffered) {
+        std::ios::sync_with_stdio(false);
+        std::cin.tie(nullptr);
+    }
+    int N;
+    std::cin >> N;
+    Proxy proxy;
+    for (int i = 0; i < N; ++i) {
+        int area;
+        std::cin >> area;
+        proxy.requestHouse(area);
+        if (!buffered) {
+            std::cout.flush();
+        }
+    }
+    std::cout.flush();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::remove(inputPath);
+
+    std::fprintf(stderr, "%s: %d requests in %.1f ms, %.0f ns/request\n", mode.c_str(), N, seconds * 1e3,
+                 seconds * 1e9 / N);
+    return 0;
+}
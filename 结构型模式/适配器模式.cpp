@@ -34,7 +34,7 @@ public:
 class USBAdapter : public USB {
 public:
     void chargeWithUSB() override {
-        std::cout << "USB Adapter" << std::endl;
+        std::cout << "USB Adapter" << '\n';
     }
 };
 
@@ -45,7 +45,7 @@ public:
     explicit Computer(USBAdapter *adapter) : adapter(adapter) {}
 
     void chargeWithTypeC() override {
-        std::cout << "TypeC" << std::endl;
+        std::cout << "TypeC" << '\n';
     }
 
     void chargeWithUSB() {
@@ -57,6 +57,8 @@ public:
 };
 
 int main() {
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(nullptr);
     int N;
     std::cin >> N;
     auto* computer=new Computer(new USBAdapter());
@@ -73,7 +75,7 @@ int main() {
             }
         }catch (const std::exception& e){
             //捕获try中抛出的错误，并将其打印
-            std::cout<<"Error-"<<e.what()<<std::endl;
+            std::cout<<"Error-"<<e.what()<<'\n';
         }
     }
     delete computer;
@@ -66,7 +66,7 @@ ConcreteChatUser::ConcreteChatUser(const std::string& name, ChatRoomMediator* me
 void ConcreteChatUser::receiveMessage(const std::string& sender, const std::string& message) {
     std::string receivedMessage = getName() + " received: " + message;
     addReceivedMessage(receivedMessage);
-    std::cout << receivedMessage << std::endl; 
+    std::cout << receivedMessage << '\n'; 
 }
 
 // 抽象中介者
@@ -111,6 +111,8 @@ void ChatUser::sendMessage(const std::string& message) {
 }
 
 int main() {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
     std::vector<std::string> userNames;
     int N;
     std::cin >> N;
@@ -1,6 +1,26 @@
 #include<iostream>
 #include<vector>
 #include <string>
+#include <memory>
+#include <unordered_map>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <cerrno>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 using namespace std;
 
@@ -18,7 +38,33 @@ using namespace std;
 class FoodMaker{
 public:
     void makeFood(const string& dishName){
-        cout<<dishName<<" is ready!"<<endl;
+        cout<<dishName<<" is ready!"<<'\n';
+    }
+};
+
+//菜名驻留表：相同菜名只保存一份，命令中只需保存一个整数ID，而不必各自拷贝一份字符串
+class DishTable{
+private:
+    unordered_map<string, int> ids;
+    vector<string> names;
+public:
+    int intern(const string& dishName){
+        auto it= this->ids.find(dishName);
+        if(it!= this->ids.end()){
+            return it->second;
+        }
+        int id=static_cast<int>(this->names.size());
+        this->names.emplace_back(dishName);
+        this->ids.emplace(dishName, id);
+        return id;
+    }
+
+    const string& name(int id) const{
+        return this->names[id];
+    }
+
+    int size() const{
+        return static_cast<int>(this->names.size());
     }
 };
 
@@ -43,33 +89,699 @@ public:
     }
 };
 
+//具体命令类（按值传递版本）：只保存菜名ID与接收者，不需要new，也不需要虚函数
+class OrderFoodById{
+private:
+    int dishId;
+    const DishTable* dishes;
+    FoodMaker* receiver;
+public:
+    explicit OrderFoodById(int dishId, const DishTable* dishes, FoodMaker* receiver):dishId(dishId), dishes(dishes), receiver(receiver){}
+
+    int getDishId() const{
+        return this->dishId;
+    }
+
+    const DishTable& getDishes() const{
+        return *this->dishes;
+    }
+
+    void execute() const{
+        receiver->makeFood(this->dishes->name(this->dishId));
+    }
+};
+
+//把传统的Command*包装成可按值存放的命令，使两种命令都能交给同一个调用者
+class CommandRef{
+private:
+    Command* command;
+public:
+    explicit CommandRef(Command* command):command(command){}
+
+    void execute() const{
+        this->command->execute();
+    }
+};
+
+/* 小缓冲区命令：类型擦除的命令对象。
+ * 任何带有execute()方法、且大小不超过capacity的类型都可以直接构造在内部缓冲区中，
+ * 调用时通过一张静态函数表分派，因此创建、移动、执行命令都不会触碰堆。
+ * 超出容量的类型在编译期报错，而不是悄悄退化为堆分配。
+ */
+class InplaceCommand{
+public:
+    static constexpr size_t capacity=32;
+private:
+    struct Ops{
+        void (*execute)(void* self);
+        void (*relocate)(void* dst, void* src);//移动构造到dst，并析构src
+        void (*destroy)(void* self);
+    };
+
+    template<typename T>
+    static const Ops* opsFor(){
+        static constexpr Ops ops{
+            [](void* self){ static_cast<T*>(self)->execute(); },
+            [](void* dst, void* src){
+                new(dst) T(std::move(*static_cast<T*>(src)));
+                static_cast<T*>(src)->~T();
+            },
+            [](void* self){ static_cast<T*>(self)->~T(); }
+        };
+        return &ops;
+    }
+
+    alignas(max_align_t) unsigned char storage[capacity];
+    const Ops* ops=nullptr;
+
+    void moveFrom(InplaceCommand& other) noexcept{
+        if(other.ops!=nullptr){
+            other.ops->relocate(this->storage, other.storage);
+            this->ops=other.ops;
+            other.ops=nullptr;
+        }
+    }
+public:
+    InplaceCommand()=default;
+
+    template<typename T, typename=enable_if_t<!is_same_v<decay_t<T>, InplaceCommand>>>
+    InplaceCommand(T&& command){
+        using Concrete=decay_t<T>;
+        static_assert(sizeof(Concrete)<=capacity && alignof(Concrete)<=alignof(max_align_t),
+                      "command does not fit in InplaceCommand's small buffer");
+        static_assert(is_nothrow_move_constructible_v<Concrete>, "command must be nothrow movable");
+        new(this->storage) Concrete(std::forward<T>(command));
+        this->ops=opsFor<Concrete>();
+    }
+
+    InplaceCommand(InplaceCommand&& other) noexcept{
+        moveFrom(other);
+    }
+
+    InplaceCommand& operator=(InplaceCommand&& other) noexcept{
+        if(this!=&other){
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    InplaceCommand(const InplaceCommand&)=delete;
+    InplaceCommand& operator=(const InplaceCommand&)=delete;
+
+    void execute(){
+        this->ops->execute(this->storage);
+    }
+
+    void reset(){
+        if(this->ops!=nullptr){
+            this->ops->destroy(this->storage);
+            this->ops=nullptr;
+        }
+    }
+
+    explicit operator bool() const{
+        return this->ops!=nullptr;
+    }
+
+    ~InplaceCommand(){
+        reset();
+    }
+};
+
+//日志文件的只读映射，离开作用域时自动解除
+class JournalMapping{
+private:
+    void* base=MAP_FAILED;
+    size_t length=0;
+public:
+    explicit JournalMapping(int fd){
+        struct stat st{};
+        if(fstat(fd, &st)<0){
+            throw runtime_error("cannot stat journal");
+        }
+        this->length=static_cast<size_t>(st.st_size);
+        if(this->length>0){
+            this->base=mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(this->base==MAP_FAILED){
+                throw runtime_error("cannot map journal");
+            }
+            madvise(this->base, this->length, MADV_SEQUENTIAL);
+        }
+    }
+
+    JournalMapping(const JournalMapping&)=delete;
+    JournalMapping& operator=(const JournalMapping&)=delete;
+
+    const char* data() const{
+        return static_cast<const char*>(this->base);
+    }
+
+    size_t size() const{
+        return this->length;
+    }
+
+    ~JournalMapping(){
+        if(this->base!=MAP_FAILED){
+            munmap(this->base, this->length);
+        }
+    }
+};
+
+/* 顺序扫描日志记录：每条完整的'D'记录调用onDefine(id, 菜名指针, 长度)，每条'O'记录调用onOrder(id)。
+ * 每次会话的菜名ID都从0起连续分配，所以合法的'D'记录的ID不会超过已定义的ID数（等于时是新定义，
+ * 小于时是新会话重新定义），菜名也不会为空；不满足的'D'记录只能是垃圾，不能按它的ID去扩容。
+ * 遇到写到一半的记录、无法识别的记录类型、不合法的'D'记录或引用了未定义菜名ID的'O'记录即停止，
+ * 返回最后一条完整记录之后的偏移量；整个文件都有效时等于size。
+ */
+template<typename OnDefine, typename OnOrder>
+size_t scanJournal(const char* data, size_t size, OnDefine onDefine, OnOrder onOrder){
+    vector<bool> defined;
+    size_t offset=0;
+    while(offset<size){
+        const char* p=data+offset;
+        size_t left=size-offset;
+        uint32_t id;
+        if(*p=='O'){
+            if(left<5){
+                break;
+            }
+            memcpy(&id, p+1, sizeof(id));
+            if(id>=defined.size()||!defined[id]){
+                break;
+            }
+            onOrder(id);
+            offset+=5;
+        }else if(*p=='D'){
+            uint16_t len;
+            if(left<7){
+                break;
+            }
+            memcpy(&id, p+1, sizeof(id));
+            memcpy(&len, p+5, sizeof(len));
+            if(left<7+size_t{len}||id>defined.size()||len==0){
+                break;
+            }
+            if(id==defined.size()){
+                defined.push_back(true);
+            }
+            defined[id]=true;
+            onDefine(id, p+7, len);
+            offset+=7+size_t{len};
+        }else{
+            break;
+        }
+    }
+    return offset;
+}
+
+/* 命令日志：每条执行过的命令以紧凑的二进制记录追加到日志文件末尾，崩溃后可据此重建厨房队列。
+ * 记录格式（按本机字节序写入）：
+ *   'D' uint32 菜名ID uint16 长度 菜名字节   —— 该菜名ID首次出现时写入一次
+ *   'O' uint32 菜名ID                        —— 一条点餐命令，固定5字节
+ * 采用组提交：记录先攒在内存缓冲区中，攒满groupSize条后一次write+fdatasync，
+ * 把一次落盘的开销分摊到整组命令上。析构时提交剩余记录。
+ * 打开已有日志时先扫描一遍，把上次崩溃留下的不完整尾部截掉，新记录才不会接在垃圾后面。
+ */
+class CommandJournal{
+private:
+    int fd;
+    vector<char> buffer;
+    size_t pending=0;
+    size_t groupSize;
+    int journaledDishes=0;//本次会话已写入'D'记录的菜名数
+    size_t truncated=0;//打开时截掉的尾部字节数
+
+    void put(const void* data, size_t size){
+        const char* bytes=static_cast<const char*>(data);
+        this->buffer.insert(this->buffer.end(), bytes, bytes+size);
+    }
+public:
+    explicit CommandJournal(const string& path, size_t groupSize=4096):groupSize(groupSize){
+        this->fd=open(path.c_str(), O_RDWR|O_CREAT|O_APPEND, 0644);
+        if(this->fd<0){
+            throw runtime_error("cannot open journal: "+path);
+        }
+        try{
+            repairTail();
+        }catch(...){
+            close(this->fd);
+            throw;
+        }
+        this->buffer.reserve(groupSize*5+4096);
+    }
+
+    //截到最后一条完整记录为止
+    void repairTail(){
+        size_t size, valid;
+        {
+            JournalMapping mapping(this->fd);
+            size=mapping.size();
+            valid=scanJournal(mapping.data(), size, [](uint32_t, const char*, uint16_t){}, [](uint32_t){});
+        }
+        if(valid<size){
+            if(ftruncate(this->fd, static_cast<off_t>(valid))<0||fdatasync(this->fd)<0){
+                throw runtime_error("cannot truncate torn journal tail");
+            }
+            this->truncated=size-valid;
+        }
+    }
+
+    size_t truncatedBytes() const{
+        return this->truncated;
+    }
+
+    CommandJournal(const CommandJournal&)=delete;
+    CommandJournal& operator=(const CommandJournal&)=delete;
+
+    void append(const DishTable& dishes, int dishId){
+        //菜名ID是连续分配的，补写所有尚未记录的菜名定义
+        while(this->journaledDishes<=dishId){
+            const string& name=dishes.name(this->journaledDishes);
+            //长度字段只有16位，超长的菜名截断长度会使之后的记录全部错位；重放时空菜名视为损坏
+            if(name.size()>UINT16_MAX){
+                throw length_error("dish name too long for journal");
+            }
+            if(name.empty()){
+                throw length_error("empty dish name cannot be journaled");
+            }
+            uint32_t id=this->journaledDishes++;
+            uint16_t len=static_cast<uint16_t>(name.size());
+            this->buffer.push_back('D');
+            put(&id, sizeof(id));
+            put(&len, sizeof(len));
+            put(name.data(), len);
+        }
+        uint32_t id=dishId;
+        this->buffer.push_back('O');
+        put(&id, sizeof(id));
+        if(++this->pending>=this->groupSize){
+            commit();
+        }
+    }
+
+    //组提交：一次写入并落盘当前缓冲区中的所有记录。被信号打断时重试；
+    //写入失败时只保留未写出的部分，避免之后再提交时重复写入已落到文件里的字节
+    void commit(){
+        size_t written=0;
+        while(written<this->buffer.size()){
+            ssize_t n=write(this->fd, this->buffer.data()+written, this->buffer.size()-written);
+            if(n<0){
+                if(errno==EINTR){
+                    continue;
+                }
+                this->buffer.erase(this->buffer.begin(), this->buffer.begin()+written);
+                throw runtime_error(string("journal write failed: ")+strerror(errno));
+            }
+            written+=n;
+        }
+        this->buffer.clear();
+        this->pending=0;
+        if(written>0){
+            int result;
+            do{
+                result=fdatasync(this->fd);
+            }while(result<0&&errno==EINTR);
+            if(result<0){
+                throw runtime_error(string("journal fdatasync failed: ")+strerror(errno));
+            }
+        }
+    }
+
+    ~CommandJournal(){
+        try{
+            commit();
+        }catch(const exception&){
+        }
+        close(this->fd);
+    }
+};
+
+//装饰器命令：先执行被包装的点餐命令，再把它写入日志
+class JournaledOrder{
+private:
+    OrderFoodById order;
+    CommandJournal* journal;
+public:
+    explicit JournaledOrder(const OrderFoodById& order, CommandJournal* journal):order(order), journal(journal){}
+
+    void execute(){
+        this->order.execute();
+        this->journal->append(this->order.getDishes(), this->order.getDishId());
+    }
+};
+
 //调用者类（点餐机）
 class OrderMachine{
 private:
-    Command* command;
+    InplaceCommand command;
 public:
     void setCommand(Command* command){
-        this->command=command;
+        this->command=CommandRef(command);
+    }
+
+    void setCommand(InplaceCommand command){
+        this->command=std::move(command);
     }
 
     void executeOrder(){
-        this->command->execute();
+        this->command.execute();
+    }
+};
+
+//延迟直方图：按2的幂划分纳秒区间，各桶为原子计数，执行线程可无锁并发记录
+class LatencyHistogram{
+public:
+    static constexpr int bucketCount=64;
+private:
+    atomic<uint64_t> buckets[bucketCount]{};
+public:
+    void record(uint64_t nanos){
+        int bucket=nanos==0?0:64-__builtin_clzll(nanos);
+        this->buckets[bucket<bucketCount?bucket:bucketCount-1].fetch_add(1, memory_order_relaxed);
+    }
+
+    uint64_t count() const{
+        uint64_t total=0;
+        for(const auto& bucket: this->buckets){
+            total+=bucket.load(memory_order_relaxed);
+        }
+        return total;
+    }
+
+    //返回第q分位数所在桶的上界（纳秒），精度为2倍以内；没有样本时返回0
+    uint64_t percentile(double q) const{
+        uint64_t total=count();
+        if(total==0){
+            return 0;
+        }
+        //q=1时q*total等于total，没有哪个桶能让seen超过它，要夹到最后一个样本
+        uint64_t rank=q<=0?0:min(static_cast<uint64_t>(q*total), total-1);
+        uint64_t seen=0;
+        for(int i=0;i<bucketCount;++i){
+            seen+= this->buckets[i].load(memory_order_relaxed);
+            if(seen>rank){
+                return i==0?0:(i>=63?UINT64_MAX:(uint64_t{1}<<i));
+            }
+        }
+        return 0;
+    }
+};
+
+/* 带截止时间的优先级调度器：替代OrderMachine的严格先来先服务。
+ * 每条命令带一个优先级类别（0最紧急）与截止时间，先按类别、同类别内按截止时间最早者优先（EDF），
+ * 同截止时间再按提交顺序。待执行队列是一个4叉最小堆，堆中只存16字节的键，
+ * 命令本身放在槽位池中按下标引用，上滤/下滤时搬动的数据少、访问集中。
+ * 多个执行线程从堆顶取命令，在锁外执行，并按类别记录从提交到完成的延迟以及错过截止时间的次数。
+ */
+class DeadlineScheduler{
+public:
+    using Clock=chrono::steady_clock;
+private:
+    static constexpr size_t arity=4;
+
+    struct Key{
+        int64_t deadline;//截止时间，纳秒
+        uint32_t seq;
+        uint16_t priority;
+        uint16_t slot;
+    };
+    struct Slot{
+        InplaceCommand command;
+        Clock::time_point submitted;
+        Clock::time_point deadline;
+        int priority=0;
+    };
+    struct ClassStats{
+        LatencyHistogram latency;
+        atomic<uint64_t> missed{0};
+        atomic<uint64_t> failed{0};//execute抛出异常的命令数
+    };
+
+    vector<Key> heap;
+    vector<Slot> slots;
+    vector<uint16_t> freeSlots;
+    unique_ptr<ClassStats[]> stats;
+    int priorityClasses=0;
+    uint32_t nextSeq=0;
+    size_t running=0;
+    bool stopping=false;
+    mutex lock;
+    condition_variable notEmpty;
+    condition_variable notFull;
+    condition_variable idle;
+    vector<thread> workers;
+
+    static bool before(const Key& a, const Key& b){
+        if(a.priority!=b.priority) return a.priority<b.priority;
+        if(a.deadline!=b.deadline) return a.deadline<b.deadline;
+        return static_cast<int32_t>(a.seq-b.seq)<0;
+    }
+
+    void siftUp(size_t i){
+        Key key= this->heap[i];
+        while(i>0){
+            size_t parent=(i-1)/arity;
+            if(!before(key, this->heap[parent])) break;
+            this->heap[i]= this->heap[parent];
+            i=parent;
+        }
+        this->heap[i]=key;
+    }
+
+    void siftDown(size_t i){
+        size_t n= this->heap.size();
+        Key key= this->heap[i];
+        while(true){
+            size_t first=i*arity+1;
+            if(first>=n) break;
+            size_t best=first;
+            size_t last=min(first+arity, n);
+            for(size_t c=first+1;c<last;++c){
+                if(before(this->heap[c], this->heap[best])) best=c;
+            }
+            if(!before(this->heap[best], key)) break;
+            this->heap[i]= this->heap[best];
+            i=best;
+        }
+        this->heap[i]=key;
+    }
+
+    void workerLoop(){
+        unique_lock<mutex> guard(this->lock);
+        while(true){
+            this->notEmpty.wait(guard, [this]{ return this->stopping||!this->heap.empty(); });
+            if(this->heap.empty()) return;//stopping且队列已清空
+
+            uint16_t slotIndex= this->heap[0].slot;
+            this->heap[0]= this->heap.back();
+            this->heap.pop_back();
+            if(!this->heap.empty()) siftDown(0);
+            Slot& slot= this->slots[slotIndex];
+            InplaceCommand command=std::move(slot.command);
+            Clock::time_point submitted=slot.submitted;
+            Clock::time_point deadline=slot.deadline;
+            int priority=slot.priority;
+            this->freeSlots.push_back(slotIndex);
+            ++this->running;
+            this->notFull.notify_one();
+
+            guard.unlock();
+            ClassStats& classStats= this->stats[priority];
+            //异常不能逃出执行线程（那会调用std::terminate），按类别计数后继续取下一条
+            try{
+                command.execute();
+            }catch(...){
+                classStats.failed.fetch_add(1, memory_order_relaxed);
+            }
+            Clock::time_point done=Clock::now();
+            classStats.latency.record(chrono::duration_cast<chrono::nanoseconds>(done-submitted).count());
+            if(done>deadline){
+                classStats.missed.fetch_add(1, memory_order_relaxed);
+            }
+            guard.lock();
+
+            if(--this->running==0&&this->heap.empty()){
+                this->idle.notify_all();
+            }
+        }
+    }
+public:
+    //capacity为最多同时排队的命令数，队列满时submit阻塞；
+    //没有执行线程或容量为0时submit/drain会永远等下去，直接拒绝
+    explicit DeadlineScheduler(int threads, int priorityClasses=3, size_t capacity=4096){
+        if(threads<=0){
+            throw invalid_argument("scheduler needs at least one thread");
+        }
+        if(priorityClasses<=0){
+            throw invalid_argument("scheduler needs at least one priority class");
+        }
+        if(capacity==0){
+            throw invalid_argument("scheduler capacity must be positive");
+        }
+        this->stats.reset(new ClassStats[priorityClasses]);
+        this->priorityClasses=priorityClasses;
+        capacity=min<size_t>(capacity, UINT16_MAX);
+        this->heap.reserve(capacity);
+        this->slots.resize(capacity);
+        for(size_t i=capacity;i>0;--i){
+            this->freeSlots.push_back(static_cast<uint16_t>(i-1));
+        }
+        for(int i=0;i<threads;++i){
+            this->workers.emplace_back([this]{ workerLoop(); });
+        }
+    }
+
+    DeadlineScheduler(const DeadlineScheduler&)=delete;
+    DeadlineScheduler& operator=(const DeadlineScheduler&)=delete;
+
+    void submit(InplaceCommand command, int priority, Clock::time_point deadline){
+        if(priority<0||priority>=this->priorityClasses){
+            throw invalid_argument("priority class out of range");
+        }
+        Clock::time_point now=Clock::now();
+        unique_lock<mutex> guard(this->lock);
+        this->notFull.wait(guard, [this]{ return !this->freeSlots.empty(); });
+        uint16_t slotIndex= this->freeSlots.back();
+        this->freeSlots.pop_back();
+        Slot& slot= this->slots[slotIndex];
+        slot.command=std::move(command);
+        slot.submitted=now;
+        slot.deadline=deadline;
+        slot.priority=priority;
+        int64_t deadlineNanos=chrono::duration_cast<chrono::nanoseconds>(deadline.time_since_epoch()).count();
+        this->heap.push_back(Key{deadlineNanos, this->nextSeq++, static_cast<uint16_t>(priority), slotIndex});
+        siftUp(this->heap.size()-1);
+        this->notEmpty.notify_one();
+    }
+
+    //等待所有已提交的命令执行完毕
+    void drain(){
+        unique_lock<mutex> guard(this->lock);
+        this->idle.wait(guard, [this]{ return this->heap.empty()&& this->running==0; });
+    }
+
+    const LatencyHistogram& latency(int priority) const{
+        return this->stats[priority].latency;
+    }
+
+    uint64_t missedDeadlines(int priority) const{
+        return this->stats[priority].missed.load(memory_order_relaxed);
+    }
+
+    uint64_t failedCommands(int priority) const{
+        return this->stats[priority].failed.load(memory_order_relaxed);
+    }
+
+    ~DeadlineScheduler(){
+        {
+            lock_guard<mutex> guard(this->lock);
+            this->stopping=true;
+        }
+        this->notEmpty.notify_all();
+        for(auto& worker: this->workers){
+            worker.join();
+        }
+    }
+};
+
+/* 日志重放：把日志文件整体映射到内存中顺序解析，逐条重新执行其中的命令。
+ * 日志中的菜名ID只在写入它的那次会话内有效，因此先通过'D'记录映射为本地DishTable中的ID。
+ * 末尾不完整或损坏的记录（写到一半时崩溃）不抛异常：重放到最后一条完整记录为止，
+ * 并在结果中报告被忽略的字节数。
+ */
+class JournalReplayer{
+public:
+    struct Result{
+        long long commands=0;
+        size_t ignoredBytes=0;
+    };
+
+    static Result replay(const string& path, DishTable& dishes, FoodMaker* receiver){
+        int fd=open(path.c_str(), O_RDONLY);
+        if(fd<0){
+            throw runtime_error("cannot open journal: "+path);
+        }
+        unique_ptr<JournalMapping> mapping;
+        try{
+            mapping=make_unique<JournalMapping>(fd);
+        }catch(...){
+            close(fd);
+            throw;
+        }
+        close(fd);
+
+        vector<int> localIds;
+        OrderMachine orderMachine{};
+        Result result;
+        size_t valid=scanJournal(mapping->data(), mapping->size(),
+            [&](uint32_t id, const char* name, uint16_t len){
+                if(id>=localIds.size()){
+                    localIds.resize(id+size_t{1}, -1);
+                }
+                localIds[id]=dishes.intern(string(name, len));
+            },
+            [&](uint32_t id){
+                orderMachine.setCommand(OrderFoodById(localIds[id], &dishes, receiver));
+                orderMachine.executeOrder();
+                ++result.commands;
+            });
+        result.ignoredBytes=mapping->size()-valid;
+        return result;
     }
 };
 
-int main() {
+//用法：命令模式 [--journal 日志文件] 或 命令模式 --replay 日志文件
+int runKitchen(const string& option, const char* path) {
+    FoodMaker foodMaker;
+    DishTable dishes;
+    if (option=="--replay") {
+        JournalReplayer::Result result=JournalReplayer::replay(path, dishes, &foodMaker);
+        if (result.ignoredBytes>0) {
+            cerr<<"journal: ignored "<<result.ignoredBytes<<" bytes after the last complete record"<<'\n';
+        }
+        return 0;
+    }
+    unique_ptr<CommandJournal> journal;
+    if (option=="--journal") {
+        journal=make_unique<CommandJournal>(path);
+        if (journal->truncatedBytes()>0) {
+            cerr<<"journal: truncated "<<journal->truncatedBytes()<<" bytes of torn tail"<<'\n';
+        }
+    }
+
     int N;
     cin >> N;
-    vector<string> dishes(N);
-    FoodMaker foodMaker;
+    OrderMachine orderMachine{};
+    //dish放在循环外复用其缓冲区；菜名重复出现时只查表，稳态下每单零堆分配
+    string dish;
     while (N--) {
-        string dish;
         cin >> dish;
-        Command* command = new OrderFood(dish, &foodMaker);
-        OrderMachine orderMachine{};
-        orderMachine.setCommand(command);
+        OrderFoodById order(dishes.intern(dish), &dishes, &foodMaker);
+        if (journal) {
+            orderMachine.setCommand(JournaledOrder(order, journal.get()));
+        } else {
+            orderMachine.setCommand(order);
+        }
         orderMachine.executeOrder();
-        delete command;
     }
     return 0;
-}
\ No newline at end of file
+}
+
+int main(int argc, char* argv[]) {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+    string option=argc>1?argv[1]:"";
+    bool known=argc==1||(argc==3&&(option=="--journal"||option=="--replay"));
+    if (!known) {
+        cerr<<"usage: "<<argv[0]<<" [--journal FILE | --replay FILE]"<<'\n';
+        return 2;
+    }
+    try {
+        return runKitchen(option, argc>2?argv[2]:nullptr);
+    } catch (const exception& e) {
+        cout.flush();
+        cerr<<"Error: "<<e.what()<<'\n';
+        return 1;
+    }
+}
@@ -0,0 +1,227 @@
+/* 命令模式的基准测试。
+ * alloc：每单的堆分配次数与耗时，对比原来的new OrderFood+虚调用+delete与驻留菜名ID的InplaceCommand。
+ *   本文件替换了全局operator new来计数，菜名超过短字符串优化的长度，原来的做法每单还要拷贝一次字符串。
+ * journal：日志的每条命令写入开销（带日志与不带日志执行同样的订单，差值即日志开销，含组提交落盘），
+ *   以及把整个日志映射后重放的吞吐。日志文件默认写到/tmp，1e8条约500MB。
+ * schedule：突发负载下各优先级类别的p50/p99延迟与错过截止时间的比例。每4ms来一批100条命令，
+ *   10%紧急（5-15us，截止0.5ms）、30%普通（5-15us，截止2ms）、60%长命令（20-100us，截止8ms），
+ *   对比按到达顺序执行与DeadlineScheduler按类别+最早截止时间执行。
+ * 输出都写入一个丢弃数据的streambuf，只测命令本身的开销。
+ * 编译：g++ -std=c++17 -O2 -pthread 命令模式_benchmark.cpp
+ * 用法：命令模式_benchmark alloc [订单数，默认1e7]
+ *       命令模式_benchmark journal [命令数，默认1e7] [日志文件]
+ *       命令模式_benchmark schedule [批数，默认200]
+ */
+//复用模式程序中的类，程序自己的main改名后不使用
+#define main commandProgramMain
+#include "命令模式.cpp"
+#undef main
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+static unsigned long long allocations=0;
+
+void* operator new(size_t size){
+    ++allocations;
+    if(void* p=malloc(size==0?1:size)){
+        return p;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept{
+    free(p);
+}
+
+//丢弃所有写入的数据
+class NullBuffer:public streambuf{
+protected:
+    int overflow(int c) override{
+        return c;
+    }
+
+    streamsize xsputn(const char*, streamsize n) override{
+        return n;
+    }
+};
+
+using BenchClock=chrono::steady_clock;
+
+double secondsSince(BenchClock::time_point start){
+    return chrono::duration<double>(BenchClock::now()-start).count();
+}
+
+static const char* const dishNames[]={"Braised_Pork_With_Brown_Sauce", "Kung_Pao_Chicken_Extra_Spicy",
+                                      "Hot_And_Sour_Soup_Large_Bowl", "Yangzhou_Fried_Rice_Special"};
+
+void benchmarkAllocations(long long orders){
+    FoodMaker foodMaker;
+    vector<string> input;
+    for(long long i=0;i<1024;++i){
+        input.emplace_back(dishNames[(i*7)%4]);
+    }
+
+    //原来的做法：每单new一个持有菜名副本的OrderFood，虚调用后delete
+    OrderMachine orderMachine{};
+    unsigned long long before=allocations;
+    auto start=BenchClock::now();
+    for(long long i=0;i<orders;++i){
+        Command* command=new OrderFood(input[i&1023], &foodMaker);
+        orderMachine.setCommand(command);
+        orderMachine.executeOrder();
+        delete command;
+    }
+    double legacySeconds=secondsSince(start);
+    double legacyAllocations=static_cast<double>(allocations-before)/orders;
+
+    //现在的做法：菜名驻留为ID，命令按值构造在InplaceCommand的内部缓冲区里
+    DishTable dishes;
+    before=allocations;
+    start=BenchClock::now();
+    for(long long i=0;i<orders;++i){
+        orderMachine.setCommand(OrderFoodById(dishes.intern(input[i&1023]), &dishes, &foodMaker));
+        orderMachine.executeOrder();
+    }
+    double inplaceSeconds=secondsSince(start);
+    double inplaceAllocations=static_cast<double>(allocations-before)/orders;
+    //稳态：菜名都已驻留之后再跑一轮
+    before=allocations;
+    for(long long i=0;i<orders;++i){
+        orderMachine.setCommand(OrderFoodById(dishes.intern(input[i&1023]), &dishes, &foodMaker));
+        orderMachine.executeOrder();
+    }
+    unsigned long long steadyAllocations=allocations-before;
+
+    printf("%lld orders\n", orders);
+    printf("new OrderFood per order: %.3f allocations/order, %.1f ns/order\n", legacyAllocations, legacySeconds*1e9/orders);
+    printf("InplaceCommand + dish ID: %.6f allocations/order, %.1f ns/order (steady state: %llu allocations)\n",
+           inplaceAllocations, inplaceSeconds*1e9/orders, steadyAllocations);
+}
+
+void benchmarkJournal(long long commands, const string& path){
+    FoodMaker foodMaker;
+    DishTable dishes;
+    for(const char* name: dishNames){
+        dishes.intern(name);
+    }
+    OrderMachine orderMachine{};
+    auto start=BenchClock::now();
+    for(long long i=0;i<commands;++i){
+        orderMachine.setCommand(OrderFoodById(static_cast<int>(i&3), &dishes, &foodMaker));
+        orderMachine.executeOrder();
+    }
+    double plainSeconds=secondsSince(start);
+
+    unlink(path.c_str());
+    start=BenchClock::now();
+    {
+        CommandJournal journal(path);
+        for(long long i=0;i<commands;++i){
+            orderMachine.setCommand(JournaledOrder(OrderFoodById(static_cast<int>(i&3), &dishes, &foodMaker), &journal));
+            orderMachine.executeOrder();
+        }
+    }
+    double journaledSeconds=secondsSince(start);
+
+    DishTable replayed;
+    start=BenchClock::now();
+    JournalReplayer::Result result=JournalReplayer::replay(path, replayed, &foodMaker);
+    double replaySeconds=secondsSince(start);
+    struct stat st{};
+    stat(path.c_str(), &st);
+    unlink(path.c_str());
+
+    printf("%lld commands, journal %.1f MB\n", commands, st.st_size/1e6);
+    printf("without journal: %.1f ns/command\n", plainSeconds*1e9/commands);
+    printf("with journal:    %.1f ns/command (overhead %.1f ns/command, group commit every 4096)\n",
+           journaledSeconds*1e9/commands, (journaledSeconds-plainSeconds)*1e9/commands);
+    printf("replay: %lld commands in %.2f s, %.2f M commands/s%s\n", result.commands, replaySeconds,
+           result.commands/replaySeconds/1e6, result.commands==commands&&result.ignoredBytes==0?"":" (MISMATCH)");
+}
+
+//各类别自己统计的延迟与错过次数，两种执行顺序用同一套口径
+struct ClassResult{
+    LatencyHistogram latency;
+    atomic<uint64_t> missed{0};
+};
+
+//忙等cost纳秒模拟做菜，完成时按自己的提交时间和截止时间记账；正好32字节，放得进InplaceCommand
+struct TimedCommand{
+    int64_t cost;
+    DeadlineScheduler::Clock::time_point submitted;
+    DeadlineScheduler::Clock::time_point deadline;
+    ClassResult* result;
+
+    void execute(){
+        auto until=DeadlineScheduler::Clock::now()+chrono::nanoseconds(this->cost);
+        while(DeadlineScheduler::Clock::now()<until){
+        }
+        auto done=DeadlineScheduler::Clock::now();
+        this->result->latency.record(chrono::duration_cast<chrono::nanoseconds>(done-this->submitted).count());
+        if(done>this->deadline){
+            this->result->missed.fetch_add(1, memory_order_relaxed);
+        }
+    }
+};
+
+//arrivalOrder为true时所有命令同一类别、截止时间取提交时刻，调度器退化为先来先服务
+void runBursts(int bursts, bool arrivalOrder, int threads){
+    static const char* const classNames[]={"urgent", "normal", "long"};
+    static const int64_t budgets[]={500000, 2000000, 8000000};
+    ClassResult results[3];
+    {
+        DeadlineScheduler scheduler(threads, 3, 8192);
+        mt19937 rng(42);
+        for(int b=0;b<bursts;++b){
+            for(int i=0;i<100;++i){
+                int priority=rng()%10==0?0:(rng()%3==0?1:2);
+                int64_t cost=priority==2?20000+rng()%80000:5000+rng()%10000;
+                auto now=DeadlineScheduler::Clock::now();
+                auto deadline=now+chrono::nanoseconds(budgets[priority]);
+                scheduler.submit(TimedCommand{cost, now, deadline, &results[priority]},
+                                 arrivalOrder?0:priority, arrivalOrder?now:deadline);
+            }
+            this_thread::sleep_for(chrono::milliseconds(4));
+        }
+        scheduler.drain();
+    }
+    for(int c=0;c<3;++c){
+        uint64_t count=results[c].latency.count();
+        printf("%-14s threads=%d %-6s n=%6llu p50<=%6.0f us p99<=%6.0f us missed %5llu (%.2f%%)\n",
+               arrivalOrder?"arrival order":"deadline", threads, classNames[c], static_cast<unsigned long long>(count),
+               results[c].latency.percentile(0.5)/1e3, results[c].latency.percentile(0.99)/1e3,
+               static_cast<unsigned long long>(results[c].missed.load()), count==0?0.0:100.0*results[c].missed.load()/count);
+    }
+}
+
+void benchmarkSchedule(int bursts){
+    runBursts(bursts, true, 1);
+    runBursts(bursts, false, 1);
+    runBursts(bursts, false, 2);
+}
+
+int main(int argc, char* argv[]){
+    string mode=argc>1?argv[1]:"";
+    long long count=argc>2?atoll(argv[2]):0;
+    NullBuffer nullBuffer;
+    streambuf* saved=cout.rdbuf(&nullBuffer);
+    int result=0;
+    if(mode=="alloc"){
+        benchmarkAllocations(count>0?count:10000000);
+    }else if(mode=="journal"){
+        benchmarkJournal(count>0?count:10000000, argc>3?argv[3]:"/tmp/命令模式_benchmark.journal");
+    }else if(mode=="schedule"){
+        benchmarkSchedule(count>0?static_cast<int>(count):200);
+    }else{
+        fprintf(stderr, "usage: 命令模式_benchmark alloc|journal|schedule [count]\n");
+        result=1;
+    }
+    cout.rdbuf(saved);
+    return result;
+}
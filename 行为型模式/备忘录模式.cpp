@@ -2,6 +2,16 @@
 #include<vector>
 #include<string>
 #include<stack>
+#include<deque>
+#include<cstdint>
+#include<cstring>
+#include<memory>
+#include<algorithm>
+#include<stdexcept>
+#include<cstdlib>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
 
 using namespace std;
 
@@ -26,45 +36,469 @@ public:
     }
 };
 
+/* 溢出文件：内存中放不下的旧历史按块追加写入一个临时文件，文件被当作栈使用——
+ * 只在逻辑末尾写入，读回时也只取最后一块，读回后的空间由下一次写入复用。
+ * 读取通过对文件的只读内存映射完成，只有真正读到的页才会被缺页载入；
+ * 读完的页用MADV_DONTNEED归还，深度撤销不会让常驻内存随历史深度增长。
+ * 文件在创建后立即unlink，进程退出时自动回收。
+ */
+class SpillFile{
+private:
+    struct Block{
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    int fd=-1;
+    vector<Block> blocks;
+    uint64_t end=0;
+    void* mapping=MAP_FAILED;
+    size_t mappedSize=0;
+
+    void ensureMapped(uint64_t limit){
+        if(limit<= this->mappedSize){
+            return;
+        }
+        if(this->mapping!=MAP_FAILED){
+            munmap(this->mapping, this->mappedSize);
+        }
+        size_t fileSize=lseek(this->fd, 0, SEEK_END);
+        this->mapping=mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, this->fd, 0);
+        if(this->mapping==MAP_FAILED){
+            this->mappedSize=0;
+            throw runtime_error("cannot map memento spill file");
+        }
+        this->mappedSize=fileSize;
+    }
+public:
+    explicit SpillFile(const string& directory){
+        string path=directory+"/memento-XXXXXX";
+        this->fd=mkstemp(&path[0]);
+        if(this->fd<0){
+            throw runtime_error("cannot create memento spill file in "+directory);
+        }
+        unlink(path.c_str());
+    }
+
+    SpillFile(const SpillFile&)=delete;
+    SpillFile& operator=(const SpillFile&)=delete;
+
+    bool empty() const{
+        return this->blocks.empty();
+    }
+
+    template<typename Iterator>
+    void push(Iterator first, Iterator last){
+        vector<uint8_t> block(first, last);
+        size_t written=0;
+        while(written<block.size()){
+            ssize_t n=pwrite(this->fd, block.data()+written, block.size()-written, this->end+written);
+            if(n<0){
+                throw runtime_error("memento spill write failed");
+            }
+            written+=n;
+        }
+        this->blocks.push_back(Block{this->end, block.size()});
+        this->end+=block.size();
+    }
+
+    //弹出最后一块，追加到bytes末尾
+    template<typename Bytes>
+    void pop(Bytes& bytes){
+        Block block= this->blocks.back();
+        this->blocks.pop_back();
+        ensureMapped(block.offset+block.size);
+        const uint8_t* data=static_cast<const uint8_t*>(this->mapping)+block.offset;
+        bytes.insert(bytes.end(), data, data+block.size);
+        //归还已读完的整页
+        uint64_t page=sysconf(_SC_PAGESIZE);
+        uint64_t firstPage=(block.offset+page-1)/page*page;
+        if(firstPage<block.offset+block.size){
+            madvise(static_cast<char*>(this->mapping)+firstPage, block.offset+block.size-firstPage, MADV_DONTNEED);
+        }
+        this->end=block.offset;
+    }
+
+    void clear(){
+        this->blocks.clear();
+        this->end=0;
+    }
+
+    ~SpillFile(){
+        if(this->mapping!=MAP_FAILED){
+            munmap(this->mapping, this->mappedSize);
+        }
+        close(this->fd);
+    }
+};
+
+/* 增量备忘录历史：不再为每次操作保存一份完整的备忘录，而是只保存状态的变化量（delta），
+ * 每隔checkpointInterval条增量保存一个完整的备忘录作为检查点。
+ * 增量用zigzag变长编码写入字节数组，每条通常只占1字节；编码的最后一个字节不带续位，
+ * 因此既能从头解码，也能从尾部往前找到一条记录的起点，撤销与重做都只需处理一条增量。
+ * 历史按“检查点+其后的增量”分段保存，内存中的字节数超过byteBudget时从最旧的段开始整段移出内存：
+ * 未指定溢出目录时直接丢弃，保证最旧的可达状态总是一个完整的检查点；
+ * 指定了溢出目录时写入SpillFile，撤销到内存中的历史用完后再逐段读回，撤销深度不再受内存限制。
+ * 重做历史同理，超出预算时把最远的部分按块写入另一个SpillFile。
+ */
+class DeltaHistory{
+private:
+    struct Segment{
+        Memento checkpoint;//本段第一条增量应用之前的完整状态
+        size_t bytes;
+        size_t records;
+    };
+    static constexpr size_t redoSpillChunk=64u<<10;
+
+    deque<uint8_t> undoBytes;
+    deque<Segment> segments;
+    deque<uint8_t> redoBytes;
+    size_t byteBudget;
+    size_t checkpointInterval;
+    unique_ptr<SpillFile> undoSpill;
+    unique_ptr<SpillFile> redoSpill;
+    vector<Segment> spilledSegments;//已写入undoSpill的段，与其中的块一一对应
+
+    static uint32_t zigzag(int delta){
+        return (static_cast<uint32_t>(delta)<<1)^static_cast<uint32_t>(delta>>31);
+    }
+
+    static int unzigzag(uint32_t code){
+        return static_cast<int>((code>>1)^(~(code&1)+1));
+    }
+
+    template<typename Bytes>
+    static size_t pushDelta(Bytes& bytes, int delta){
+        uint32_t code=zigzag(delta);
+        size_t size=0;
+        while(code>=0x80){
+            bytes.push_back(static_cast<uint8_t>(code|0x80));
+            code>>=7;
+            ++size;
+        }
+        bytes.push_back(static_cast<uint8_t>(code));
+        return size+1;
+    }
+
+    //从尾部弹出一条增量，返回其值，并通过size返回占用的字节数
+    template<typename Bytes>
+    static int popDelta(Bytes& bytes, size_t& size){
+        size_t end=bytes.size();
+        size_t begin=end-1;
+        while(begin>0&&(bytes[begin-1]&0x80)){
+            --begin;
+        }
+        uint32_t code=0;
+        for(size_t i=end;i>begin;--i){
+            code=(code<<7)|(bytes[i-1]&0x7F);
+        }
+        size=end-begin;
+        bytes.resize(begin);
+        return unzigzag(code);
+    }
+
+    void evictOldestSegment(){
+        const Segment& oldest= this->segments.front();
+        auto last= this->undoBytes.begin()+oldest.bytes;
+        if(this->undoSpill){
+            this->undoSpill->push(this->undoBytes.begin(), last);
+            this->spilledSegments.push_back(oldest);
+        }
+        this->undoBytes.erase(this->undoBytes.begin(), last);
+        this->segments.pop_front();
+    }
+
+    //把重做历史中最远的一块写入磁盘，块尾对齐到一条增量的结束位置
+    void spillRedoChunk(){
+        size_t size=redoSpillChunk;
+        while(this->redoBytes[size-1]&0x80){
+            ++size;
+        }
+        this->redoSpill->push(this->redoBytes.begin(), this->redoBytes.begin()+size);
+        this->redoBytes.erase(this->redoBytes.begin(), this->redoBytes.begin()+size);
+    }
+
+    void enforceBudget(){
+        while(memoryUsage()>this->byteBudget){
+            if(this->segments.size()>1){
+                evictOldestSegment();
+            }else if(this->redoSpill&& this->redoBytes.size()>redoSpillChunk*2){
+                spillRedoChunk();
+            }else{
+                break;
+            }
+        }
+    }
+public:
+    //spillDirectory为空时超出预算的历史直接丢弃，否则溢出到该目录下的临时文件
+    explicit DeltaHistory(size_t byteBudget, size_t checkpointInterval=1024, const string& spillDirectory="")
+            :byteBudget(byteBudget), checkpointInterval(checkpointInterval){
+        if(!spillDirectory.empty()){
+            this->undoSpill=make_unique<SpillFile>(spillDirectory);
+            this->redoSpill=make_unique<SpillFile>(spillDirectory);
+        }
+    }
+
+    //记录一次从before变为after的操作
+    void record(int before, int after){
+        if(this->segments.empty()|| this->segments.back().records>= this->checkpointInterval){
+            this->segments.push_back(Segment{Memento(before), 0, 0});
+        }
+        Segment& last= this->segments.back();
+        last.bytes+=pushDelta(this->undoBytes, after-before);
+        ++last.records;
+        enforceBudget();
+    }
+
+    void clearRedo(){
+        this->redoBytes.clear();
+        if(this->redoSpill){
+            this->redoSpill->clear();
+        }
+    }
+
+    bool canUndo() const{
+        return !this->segments.empty()||!this->spilledSegments.empty();
+    }
+
+    bool canRedo() const{
+        return !this->redoBytes.empty()||(this->redoSpill&&!this->redoSpill->empty());
+    }
+
+    //撤销一条增量，返回撤销后的状态
+    int undo(int current){
+        if(this->segments.empty()){
+            //内存中的历史已用完，从磁盘读回最近溢出的一段
+            this->segments.push_back(this->spilledSegments.back());
+            this->spilledSegments.pop_back();
+            this->undoSpill->pop(this->undoBytes);
+        }
+        size_t size;
+        int delta=popDelta(this->undoBytes, size);
+        Segment& last= this->segments.back();
+        last.bytes-=size;
+        int previous=current-delta;
+        if(--last.records==0){
+            previous=last.checkpoint.getValue();
+            this->segments.pop_back();
+        }
+        pushDelta(this->redoBytes, delta);
+        enforceBudget();
+        return previous;
+    }
+
+    //重做一条增量，返回重做后的状态
+    int redo(int current){
+        if(this->redoBytes.empty()){
+            this->redoSpill->pop(this->redoBytes);
+        }
+        size_t size;
+        int delta=popDelta(this->redoBytes, size);
+        record(current, current+delta);
+        return current+delta;
+    }
+
+    //内存层占用的字节数（不含已溢出到磁盘的历史）
+    size_t memoryUsage() const{
+        return this->undoBytes.size()+ this->redoBytes.size()+ this->segments.size()*sizeof(Segment);
+    }
+};
+
 //发起人
 class Counter{
 private:
     int value=0;
-    stack<Memento> undoStack;
-    stack<Memento> redoStack;
+    DeltaHistory history;
 public:
+    //byteBudget：撤销/重做历史最多占用的内存字节数，超出后丢弃最旧的历史，
+    //或在指定spillDirectory时溢出到磁盘
+    explicit Counter(size_t byteBudget=64u<<20, size_t checkpointInterval=1024, const string& spillDirectory="")
+            :history(byteBudget, checkpointInterval, spillDirectory){}
+
     int getValue() const{
         return this->value;
     }
     void addValue(){
-        this->redoStack=stack<Memento>();//清空redoStack
-        this->undoStack.push(Memento(this->value));
+        this->history.clearRedo();//清空重做历史
+        this->history.record(this->value, this->value+1);
         ++this->value;
     }
     void subValue(){
-        this->redoStack=stack<Memento>();//清空redoStack
-        this->undoStack.push(Memento(this->value));
+        this->history.clearRedo();
+        this->history.record(this->value, this->value-1);
         --this->value;
     }
     //撤销操作
     void undo(){
-        if(!this->undoStack.empty()){
-            this->redoStack.push(Memento(this->value));
-            this->value=this->undoStack.top().getValue();
-            this->undoStack.pop();
+        if(this->history.canUndo()){
+            this->value= this->history.undo(this->value);
         }
     }
     //重做操作
     void redo(){
-        if(!this->redoStack.empty()){
-            this->undoStack.push(Memento(this->value));
-            this->value=this->redoStack.top().getValue();
-            this->redoStack.pop();
+        if(this->history.canRedo()){
+            this->value= this->history.redo(this->value);
+        }
+    }
+    size_t historyBytes() const{
+        return this->history.memoryUsage();
+    }
+};
+
+/* 持久化（结构共享）的字节数组：用于状态很大的发起人。
+ * 数据切成4KB的叶子块，上面是32叉的索引树，节点都由shared_ptr引用。
+ * 复制整个数组只是复制根指针，因此对它拍快照是O(1)的；
+ * 写入时沿路径做写时复制：只有被其他快照共享的节点（引用计数大于1）才会被复制，
+ * 一次写入最多复制一个叶子和depth个索引节点，未被修改的部分仍由新旧版本共享。
+ * 注意：引用计数判断只适用于单线程修改同一个发起人。
+ */
+class PersistentBuffer{
+public:
+    static constexpr size_t leafBytes=4096;
+    static constexpr size_t fanout=32;
+private:
+    static constexpr int leafShift=12;
+    static constexpr int fanoutShift=5;
+
+    struct Leaf{
+        char bytes[leafBytes];
+    };
+    struct Branch{
+        shared_ptr<void> children[fanout];
+    };
+
+    shared_ptr<void> root;
+    size_t length=0;
+    int depth=0;//索引层数，0表示根就是叶子
+
+    template<typename Node>
+    static Node* makeUnique(shared_ptr<void>& node){
+        if(node.use_count()!=1){
+            node=make_shared<Node>(*static_cast<const Node*>(node.get()));
+        }
+        return static_cast<Node*>(node.get());
+    }
+
+    size_t childIndex(size_t offset, int level) const{
+        return (offset>>(leafShift+fanoutShift*(level-1)))&(fanout-1);
+    }
+
+    const Leaf* findLeaf(size_t offset) const{
+        const void* node= this->root.get();
+        for(int level= this->depth;level>0;--level){
+            node=static_cast<const Branch*>(node)->children[childIndex(offset, level)].get();
         }
+        return static_cast<const Leaf*>(node);
+    }
+
+    Leaf* mutableLeaf(size_t offset){
+        shared_ptr<void>* slot=&this->root;
+        for(int level= this->depth;level>0;--level){
+            Branch* branch=makeUnique<Branch>(*slot);
+            slot=&branch->children[childIndex(offset, level)];
+        }
+        return makeUnique<Leaf>(*slot);
+    }
+public:
+    //初始内容全为0：每一层只创建一个全零节点，由所有位置共享，构造代价只与层数有关
+    explicit PersistentBuffer(size_t length=0):length(length){
+        shared_ptr<void> node=make_shared<Leaf>();
+        size_t covered=leafBytes;
+        while(covered<length){
+            auto branch=make_shared<Branch>();
+            for(auto& child: branch->children){
+                child=node;
+            }
+            node=branch;
+            covered*=fanout;
+            ++this->depth;
+        }
+        this->root=node;
+    }
+
+    size_t size() const{
+        return this->length;
+    }
+
+    char get(size_t offset) const{
+        return findLeaf(offset)->bytes[offset&(leafBytes-1)];
+    }
+
+    void set(size_t offset, char value){
+        mutableLeaf(offset)->bytes[offset&(leafBytes-1)]=value;
+    }
+
+    //按叶子块批量写入，每个叶子只做一次路径查找与写时复制
+    void write(size_t offset, const char* data, size_t count){
+        while(count>0){
+            size_t inLeaf=offset&(leafBytes-1);
+            size_t chunk=min(count, leafBytes-inLeaf);
+            memcpy(mutableLeaf(offset)->bytes+inLeaf, data, chunk);
+            offset+=chunk;
+            data+=chunk;
+            count-=chunk;
+        }
+    }
+
+    void read(size_t offset, char* out, size_t count) const{
+        while(count>0){
+            size_t inLeaf=offset&(leafBytes-1);
+            size_t chunk=min(count, leafBytes-inLeaf);
+            memcpy(out, findLeaf(offset)->bytes+inLeaf, chunk);
+            offset+=chunk;
+            out+=chunk;
+            count-=chunk;
+        }
+    }
+};
+
+//大文档的备忘录：只持有一个与发起人共享结构的PersistentBuffer
+class DocumentMemento{
+private:
+    friend class Document;
+    PersistentBuffer state;
+    explicit DocumentMemento(const PersistentBuffer& state):state(state){}
+};
+
+//大状态发起人：创建备忘录是O(1)的根指针复制，恢复备忘录是一次根指针替换
+class Document{
+private:
+    PersistentBuffer content;
+public:
+    explicit Document(size_t size):content(size){}
+
+    char get(size_t offset) const{
+        return this->content.get(offset);
+    }
+
+    void set(size_t offset, char value){
+        this->content.set(offset, value);
+    }
+
+    void write(size_t offset, const char* data, size_t count){
+        this->content.write(offset, data, count);
+    }
+
+    void read(size_t offset, char* out, size_t count) const{
+        this->content.read(offset, out, count);
+    }
+
+    size_t size() const{
+        return this->content.size();
+    }
+
+    DocumentMemento createMemento() const{
+        return DocumentMemento(this->content);
+    }
+
+    void restore(const DocumentMemento& memento){
+        this->content=memento.state;
     }
 };
 
 int main(){
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
     string operation;
     Counter counter;
     while(cin>>operation){
@@ -77,7 +511,7 @@ int main(){
         }else if(operation=="Redo"){
             counter.redo();
         }
-        cout<<counter.getValue()<<endl;
+        cout<<counter.getValue()<<'\n';
     }
 
     return 0;
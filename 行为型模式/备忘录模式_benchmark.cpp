@@ -0,0 +1,280 @@
+/* 备忘录模式的基准测试。
+ * delta：N次操作后撤销历史占用的内存与单步撤销延迟，对比原来每次操作压入一个完整Memento的两个stack
+ *   与DeltaHistory（增量+检查点）；并给出1MiB预算下实际保留的撤销步数。内存按RSS增量统计。
+ * snapshot：大状态（默认100MB）下创建与恢复备忘录的耗时及内存开销，对比深拷贝整个字节数组的备忘录
+ *   与共享结构的Document/DocumentMemento。每两次快照之间随机改写100个字节，恢复后核对这些位置的内容。
+ * spill：N次操作的深度下，1MiB内存预算、超出部分溢出到磁盘的Counter与不设预算全放内存的Counter
+ *   的RSS和单步撤销延迟；全部撤销后应回到0，再全部重做应回到撤销前的顶端值。
+ * 编译：g++ -std=c++17 -O2 备忘录模式_benchmark.cpp
+ * 用法：备忘录模式_benchmark delta [操作数，默认1e7]
+ *       备忘录模式_benchmark snapshot [状态MB数，默认100]
+ *       备忘录模式_benchmark spill [深度，默认1e6] [溢出目录，默认/tmp]
+ */
+//复用模式程序中的类，程序自己的main改名后不使用
+#define main mementoProgramMain
+#include "备忘录模式.cpp"
+#undef main
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <malloc.h>
+#include <random>
+
+using BenchClock=chrono::steady_clock;
+
+double nanosSince(BenchClock::time_point start){
+    return chrono::duration<double, nano>(BenchClock::now()-start).count();
+}
+
+//当前进程的常驻内存，KB
+long residentKilobytes(){
+    ifstream status("/proc/self/status");
+    string line;
+    while(getline(status, line)){
+        if(line.rfind("VmRSS:", 0)==0){
+            return atol(line.c_str()+6);
+        }
+    }
+    return 0;
+}
+
+//原来的发起人：每次操作压入一个完整的Memento，历史从不裁剪
+class FullMementoCounter{
+private:
+    int value=0;
+    stack<Memento> undoStack;
+    stack<Memento> redoStack;
+public:
+    int getValue() const{
+        return this->value;
+    }
+    void addValue(){
+        this->redoStack=stack<Memento>();
+        this->undoStack.push(Memento(this->value));
+        ++this->value;
+    }
+    void subValue(){
+        this->redoStack=stack<Memento>();
+        this->undoStack.push(Memento(this->value));
+        --this->value;
+    }
+    void undo(){
+        if(!this->undoStack.empty()){
+            this->redoStack.push(Memento(this->value));
+            this->value= this->undoStack.top().getValue();
+            this->undoStack.pop();
+        }
+    }
+};
+
+//先做operations次加减，再全部撤销；返回撤销到底后是否回到初始值
+template<typename CounterType>
+bool measureHistory(const char* name, CounterType& counter, long long operations){
+    //把前一轮释放的内存还给系统，否则这一轮复用它们时RSS不增长
+    malloc_trim(0);
+    long before=residentKilobytes();
+    auto start=BenchClock::now();
+    for(long long i=0;i<operations;++i){
+        if(i%3==0){
+            counter.subValue();
+        }else{
+            counter.addValue();
+        }
+    }
+    double recordNanos=nanosSince(start)/operations;
+    long grown=residentKilobytes()-before;
+    start=BenchClock::now();
+    for(long long i=0;i<operations;++i){
+        counter.undo();
+    }
+    double undoNanos=nanosSince(start)/operations;
+    printf("%-26s %7.2f bytes/op (RSS)  record %5.1f ns/op  undo %5.1f ns/op\n", name,
+           grown*1024.0/operations, recordNanos, undoNanos);
+    return counter.getValue()==0;
+}
+
+void benchmarkDelta(long long operations){
+    printf("%lld operations\n", operations);
+    bool ok=true;
+    {
+        FullMementoCounter counter;
+        ok=measureHistory("full Memento stacks", counter, operations)&&ok;
+    }
+    {
+        Counter counter(SIZE_MAX);
+        ok=measureHistory("DeltaHistory, no budget", counter, operations)&&ok;
+        printf("  DeltaHistory bookkeeping: %.3f bytes/op\n", static_cast<double>(counter.historyBytes())/operations);
+    }
+    Counter capped(1u<<20);
+    for(long long i=0;i<operations;++i){
+        capped.addValue();
+    }
+    long long steps=0;
+    for(int previous=capped.getValue();;++steps){
+        capped.undo();
+        if(capped.getValue()==previous){
+            break;
+        }
+        previous=capped.getValue();
+    }
+    printf("1 MiB budget: %zu bytes kept, %lld undo steps still available\n", capped.historyBytes(), steps);
+    if(!ok){
+        printf("UNDO MISMATCH: history did not return to the initial value\n");
+    }
+}
+
+//每次快照前改写的位置及改写后的值，用于恢复后核对
+struct Edit{
+    size_t offset;
+    char value;
+};
+
+void benchmarkSnapshot(size_t megabytes){
+    const size_t size=megabytes<<20;
+    const int editsPerSnapshot=100;
+    mt19937_64 rng(7);
+    vector<char> initial(size);
+    for(auto& byte: initial){
+        byte=static_cast<char>(rng());
+    }
+    auto edit=[&](vector<Edit>& edits){
+        edits.clear();
+        for(int e=0;e<editsPerSnapshot;++e){
+            edits.push_back(Edit{rng()%size, static_cast<char>(rng())});
+        }
+    };
+    printf("%zu MB state, %d random byte edits between snapshots\n", megabytes, editsPerSnapshot);
+
+    //深拷贝备忘录：每个快照都是整份状态，只做少量几次
+    {
+        const int snapshots=10;
+        malloc_trim(0);
+        vector<char> document=initial;
+        long before=residentKilobytes();
+        vector<vector<char>> mementos;
+        vector<vector<Edit>> edits(snapshots);
+        double snapshotNanos=0;
+        for(int k=0;k<snapshots;++k){
+            edit(edits[k]);
+            for(const Edit& e: edits[k]){
+                document[e.offset]=e.value;
+            }
+            auto start=BenchClock::now();
+            mementos.push_back(document);
+            snapshotNanos+=nanosSince(start);
+        }
+        long grown=residentKilobytes()-before;
+        double restoreNanos=0;
+        bool ok=true;
+        for(int k=snapshots-1;k>=0;--k){
+            auto start=BenchClock::now();
+            document=mementos[k];
+            restoreNanos+=nanosSince(start);
+            for(const Edit& e: edits[k]){
+                ok=ok&&document[e.offset]==e.value;
+            }
+        }
+        printf("deep copy:  snapshot %10.0f ns  restore %10.0f ns  %8.2f MB per snapshot%s\n", snapshotNanos/snapshots,
+               restoreNanos/snapshots, grown/1024.0/snapshots, ok?"":"  RESTORE MISMATCH");
+    }
+
+    //共享结构：快照是一次根指针复制，改写时只复制被改的叶子与路径
+    {
+        const int snapshots=200;
+        malloc_trim(0);
+        Document document(size);
+        document.write(0, initial.data(), size);
+        long before=residentKilobytes();
+        vector<DocumentMemento> mementos;
+        vector<vector<Edit>> edits(snapshots);
+        double snapshotNanos=0;
+        for(int k=0;k<snapshots;++k){
+            edit(edits[k]);
+            for(const Edit& e: edits[k]){
+                document.set(e.offset, e.value);
+            }
+            auto start=BenchClock::now();
+            mementos.push_back(document.createMemento());
+            snapshotNanos+=nanosSince(start);
+        }
+        long grown=residentKilobytes()-before;
+        double restoreNanos=0;
+        bool ok=true;
+        for(int k=snapshots-1;k>=0;--k){
+            auto start=BenchClock::now();
+            document.restore(mementos[k]);
+            restoreNanos+=nanosSince(start);
+            for(const Edit& e: edits[k]){
+                ok=ok&&document.get(e.offset)==e.value;
+            }
+        }
+        printf("persistent: snapshot %10.0f ns  restore %10.0f ns  %8.2f MB per snapshot (incl. copied leaves)%s\n",
+               snapshotNanos/snapshots, restoreNanos/snapshots, grown/1024.0/snapshots, ok?"":"  RESTORE MISMATCH");
+    }
+}
+
+//做depth次加减后全部撤销、再全部重做；返回是否先回到0、再回到顶端
+bool measureSpill(const char* name, Counter& counter, long long depth){
+    malloc_trim(0);
+    long before=residentKilobytes();
+    for(long long i=0;i<depth;++i){
+        if(i%3==0){
+            counter.subValue();
+        }else{
+            counter.addValue();
+        }
+    }
+    int top=counter.getValue();
+    long recorded=residentKilobytes()-before;
+    auto start=BenchClock::now();
+    for(long long i=0;i<depth;++i){
+        counter.undo();
+    }
+    double undoNanos=nanosSince(start);
+    bool bottom=counter.getValue()==0;
+    start=BenchClock::now();
+    for(long long i=0;i<depth;++i){
+        counter.redo();
+    }
+    double redoNanos=nanosSince(start);
+    bool ok=bottom&&counter.getValue()==top;
+    printf("%-22s RSS %+9ld KB  undo %6.1f ns/step  redo %6.1f ns/step%s\n", name, recorded, undoNanos/depth,
+           redoNanos/depth, ok?"":"  UNDO/REDO MISMATCH");
+    return ok;
+}
+
+void benchmarkSpill(long long depth, const string& directory){
+    printf("depth %lld\n", depth);
+    bool ok=true;
+    {
+        Counter counter(SIZE_MAX);
+        ok=measureSpill("in RAM, no budget", counter, depth)&&ok;
+    }
+    {
+        Counter counter(1u<<20, 1024, directory);
+        ok=measureSpill("1 MiB budget + spill", counter, depth)&&ok;
+    }
+    if(!ok){
+        printf("undo/redo did not round-trip\n");
+    }
+}
+
+int main(int argc, char* argv[]){
+    string mode=argc>1?argv[1]:"";
+    long long count=argc>2?atoll(argv[2]):0;
+    if(mode=="delta"){
+        benchmarkDelta(count>0?count:10000000);
+        return 0;
+    }
+    if(mode=="snapshot"){
+        benchmarkSnapshot(count>0?static_cast<size_t>(count):100);
+        return 0;
+    }
+    if(mode=="spill"){
+        benchmarkSpill(count>0?count:1000000, argc>3?argv[3]:"/tmp");
+        return 0;
+    }
+    fprintf(stderr, "usage: 备忘录模式_benchmark delta|snapshot|spill [count] [spill directory]\n");
+    return 1;
+}
@@ -1,6 +1,14 @@
 #include<iostream>
 #include<string>
 #include <memory>
+#include <sstream>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
 
 using namespace std;
 
@@ -32,16 +40,16 @@ public:
 
     //默认添加的调料
     virtual void addCondiments(){
-        cout<<"Adding condiments"<<endl;
+        cout<<"Adding condiments"<<'\n';
     }
 
     //模板方法定义咖啡制作的全过程
     virtual void makeCoffee(){
-        cout<<"Making "<< this->coffeeName<<":"<<endl;
+        cout<<"Making "<< this->coffeeName<<":"<<'\n';
         grindCoffeeBeans();
         brewCoffee();
         addCondiments();
-        cout<<endl;
+        cout<<'\n';
     }
 
     virtual ~CoffeeMakeSystem()=default;
@@ -51,10 +59,10 @@ class AmericanCoffee:public CoffeeMakeSystem{
 public:
     AmericanCoffee(): CoffeeMakeSystem("American Coffee"){}
     void grindCoffeeBeans() override {
-        cout << "Grinding coffee beans"<<endl;
+        cout << "Grinding coffee beans"<<'\n';
     }
     void brewCoffee() override {
-        cout << "Brewing coffee"<<endl;
+        cout << "Brewing coffee"<<'\n';
     }
 };
 
@@ -64,34 +72,350 @@ public:
     LatteCoffeeMaker() : CoffeeMakeSystem("Latte") {}
 
     void grindCoffeeBeans() override {
-        cout << "Grinding coffee beans"<<endl;
+        cout << "Grinding coffee beans"<<'\n';
     }
 
     void brewCoffee() override {
-        cout << "Brewing coffee"<<endl;
+        cout << "Brewing coffee"<<'\n';
     }
 
     // 添加调料的特定实现
     void addCondiments() override {
-        cout << "Adding milk"<<endl;
-        cout << "Adding condiments"<<endl;
+        cout << "Adding milk"<<'\n';
+        cout << "Adding condiments"<<'\n';
     }
 };
 
+/* 静态分派版本的模板方法（CRTP）：
+ * 基类模板以具体子类作为模板参数，模板方法通过static_cast<Derived*>(this)调用子类的步骤，
+ * 编译期即可确定调用目标，骨架与各步骤可以一起内联，不需要虚函数表。
+ * 子类未提供的步骤（如addCondiments）使用基类中的默认实现，效果与虚函数版本的重写相同。
+ * 骨架被拆成三个阶段，串行时依次调用，流水线模式下分别在不同线程上执行，步骤顺序保持一致。
+ */
+template<typename Derived>
+class StaticCoffeeMaker{
+public:
+    //默认添加的调料
+    void addCondiments(ostream& out){
+        out<<"Adding condiments"<<'\n';
+    }
+
+    void grindStage(ostream& out){
+        out<<"Making "<<Derived::coffeeName<<":"<<'\n';
+        self().grindCoffeeBeans(out);
+    }
+
+    void brewStage(ostream& out){
+        self().brewCoffee(out);
+    }
+
+    void condimentStage(ostream& out){
+        self().addCondiments(out);
+        out<<'\n';
+    }
+
+    //模板方法定义咖啡制作的全过程
+    void makeCoffee(ostream& out=cout){
+        grindStage(out);
+        brewStage(out);
+        condimentStage(out);
+    }
+protected:
+    //只能作为基类使用
+    StaticCoffeeMaker()=default;
+    ~StaticCoffeeMaker()=default;
+private:
+    Derived& self(){
+        return static_cast<Derived&>(*this);
+    }
+};
+
+class StaticAmericanCoffee:public StaticCoffeeMaker<StaticAmericanCoffee>{
+public:
+    static constexpr const char* coffeeName="American Coffee";
+
+    void grindCoffeeBeans(ostream& out){
+        out << "Grinding coffee beans"<<'\n';
+    }
+    void brewCoffee(ostream& out){
+        out << "Brewing coffee"<<'\n';
+    }
+};
+
+class StaticLatteCoffeeMaker:public StaticCoffeeMaker<StaticLatteCoffeeMaker>{
+public:
+    static constexpr const char* coffeeName="Latte";
+
+    void grindCoffeeBeans(ostream& out){
+        out << "Grinding coffee beans"<<'\n';
+    }
+    void brewCoffee(ostream& out){
+        out << "Brewing coffee"<<'\n';
+    }
+    // 添加调料的特定实现
+    void addCondiments(ostream& out){
+        out << "Adding milk"<<'\n';
+        out << "Adding condiments"<<'\n';
+    }
+};
+
+//有界单生产者单消费者环形队列，生产者与消费者各自只写自己的下标。
+//满/空时先让出CPU自旋有限次，仍未就绪就在条件变量上睡眠，空闲的流水线不占CPU。
+//等待方先置waiting标志再检查下标，另一方先发布下标再检查标志，两边之间各有一道seq_cst栅栏，
+//因此至少有一方能看到对方的写入，不会出现双方都以为对方不需要唤醒的情况
+template<typename T, size_t Capacity>
+class SpscQueue{
+    static_assert((Capacity&(Capacity-1))==0, "capacity must be a power of two");
+private:
+    static constexpr int spinLimit=64;
+
+    T slots[Capacity];
+    alignas(64) atomic<size_t> head{0};//消费者下标
+    alignas(64) atomic<size_t> tail{0};//生产者下标
+    atomic<bool> producerWaiting{false};
+    atomic<bool> consumerWaiting{false};
+    mutex lock;
+    condition_variable notFull;
+    condition_variable notEmpty;
+
+    template<typename Ready>
+    void await(atomic<bool>& waiting, condition_variable& condition, Ready ready){
+        for(int i=0;i<spinLimit;++i){
+            if(ready()){
+                return;
+            }
+            this_thread::yield();
+        }
+        unique_lock<mutex> guard(this->lock);
+        waiting.store(true, memory_order_relaxed);
+        atomic_thread_fence(memory_order_seq_cst);
+        condition.wait(guard, ready);
+        waiting.store(false, memory_order_relaxed);
+    }
+
+    void wake(atomic<bool>& waiting, condition_variable& condition){
+        atomic_thread_fence(memory_order_seq_cst);
+        if(waiting.load(memory_order_relaxed)){
+            lock_guard<mutex> guard(this->lock);
+            condition.notify_one();
+        }
+    }
+public:
+    void push(const T& value){
+        size_t t= this->tail.load(memory_order_relaxed);
+        if(t- this->head.load(memory_order_acquire)==Capacity){
+            await(this->producerWaiting, this->notFull, [this, t]{
+                return t- this->head.load(memory_order_acquire)!=Capacity;
+            });
+        }
+        this->slots[t&(Capacity-1)]=value;
+        this->tail.store(t+1, memory_order_release);
+        wake(this->consumerWaiting, this->notEmpty);
+    }
 
-int main() {
+    T pop(){
+        size_t h= this->head.load(memory_order_relaxed);
+        if(this->tail.load(memory_order_acquire)==h){
+            await(this->consumerWaiting, this->notEmpty, [this, h]{
+                return this->tail.load(memory_order_acquire)!=h;
+            });
+        }
+        T value= this->slots[h&(Capacity-1)];
+        this->head.store(h+1, memory_order_release);
+        wake(this->producerWaiting, this->notFull);
+        return value;
+    }
+};
+
+/* 流水线模式：研磨、冲泡、加调料三个阶段各占一个线程，由有界SPSC队列串联，
+ * 多个订单可同时处于不同阶段，而每个订单仍按模板方法规定的顺序经过各阶段。
+ * 订单对象放在固定的槽位池中复用，队列中只传递槽位下标；
+ * 各阶段把输出写入订单自己的缓冲区，最后由输出线程按提交顺序写出，
+ * 因此输出与串行执行逐字节相同。
+ */
+class CoffeePipeline{
+public:
+    using Clock=chrono::steady_clock;
+
+    //每个阶段除格式化输出外额外花费的时间，用来模拟真实设备上研磨、冲泡的耗时。
+    //blocking为true时线程睡眠（等待设备），否则占着CPU忙等（计算）
+    struct StageCost{
+        chrono::nanoseconds duration;
+        bool blocking;
+
+        void spend() const{
+            if(this->duration.count()==0){
+                return;
+            }
+            if(this->blocking){
+                this_thread::sleep_for(this->duration);
+                return;
+            }
+            Clock::time_point until=Clock::now()+ this->duration;
+            while(Clock::now()<until){
+            }
+        }
+    };
+private:
+    static constexpr size_t depth=64;//同时在途的订单数
+    static constexpr uint32_t endOfStream=UINT32_MAX;
+
+    struct Order{
+        int coffeeType=0;
+        ostringstream out;
+        Clock::time_point submitted;
+    };
+    using Queue=SpscQueue<uint32_t, depth>;
+
+    Order orders[depth];
+    Queue freeSlots, toGrind, toBrew, toCondiment, toSink;
+    StaticAmericanCoffee americanCoffee;
+    StaticLatteCoffeeMaker latteCoffee;
+    ostream& sink;
+    StageCost stageCost;
+    vector<thread> workers;
+    long long completed=0;
+    long long totalLatencyNanos=0;
+
+    //咖啡机本身无状态，各阶段线程可共用
+    template<typename Step>
+    void withMaker(Order& order, Step step){
+        if(order.coffeeType==1){
+            step(this->americanCoffee);
+        }else if(order.coffeeType==2){
+            step(this->latteCoffee);
+        }
+    }
+
+    template<typename Step>
+    void runStage(Queue& in, Queue& out, Step step){
+        while(true){
+            uint32_t slot=in.pop();
+            if(slot!=endOfStream){
+                step(this->orders[slot]);
+                this->stageCost.spend();
+            }
+            out.push(slot);
+            if(slot==endOfStream){
+                return;
+            }
+        }
+    }
+
+    void runSink(){
+        while(true){
+            uint32_t slot= this->toSink.pop();
+            if(slot==endOfStream){
+                this->sink.flush();
+                return;
+            }
+            Order& order= this->orders[slot];
+            this->sink<<order.out.str();
+            this->totalLatencyNanos+=chrono::duration_cast<chrono::nanoseconds>(Clock::now()-order.submitted).count();
+            ++this->completed;
+            order.out.str("");
+            this->freeSlots.push(slot);
+        }
+    }
+public:
+    explicit CoffeePipeline(ostream& sink=cout, StageCost stageCost={chrono::nanoseconds::zero(), false}):sink(sink), stageCost(stageCost){
+        for(uint32_t i=0;i<depth;++i){
+            this->freeSlots.push(i);
+        }
+        this->workers.emplace_back([this]{
+            runStage(this->toGrind, this->toBrew, [this](Order& order){
+                if(order.coffeeType!=1&&order.coffeeType!=2){
+                    order.out<<"Invalid coffee type"<<'\n';
+                }
+                withMaker(order, [&](auto& maker){ maker.grindStage(order.out); });
+            });
+        });
+        this->workers.emplace_back([this]{
+            runStage(this->toBrew, this->toCondiment, [this](Order& order){
+                withMaker(order, [&](auto& maker){ maker.brewStage(order.out); });
+            });
+        });
+        this->workers.emplace_back([this]{
+            runStage(this->toCondiment, this->toSink, [this](Order& order){
+                withMaker(order, [&](auto& maker){ maker.condimentStage(order.out); });
+            });
+        });
+        this->workers.emplace_back([this]{ runSink(); });
+    }
+
+    CoffeePipeline(const CoffeePipeline&)=delete;
+    CoffeePipeline& operator=(const CoffeePipeline&)=delete;
+
+    //提交一个订单，在途订单已满时等待
+    void submit(int coffeeType){
+        uint32_t slot= this->freeSlots.pop();
+        Order& order= this->orders[slot];
+        order.coffeeType=coffeeType;
+        order.submitted=Clock::now();
+        this->toGrind.push(slot);
+    }
+
+    //等待所有已提交的订单完成并停止各阶段线程
+    void close(){
+        if(this->workers.empty()){
+            return;
+        }
+        this->toGrind.push(endOfStream);
+        for(auto& worker: this->workers){
+            worker.join();
+        }
+        this->workers.clear();
+    }
+
+    //close()之后有效：从提交到写出的平均延迟
+    double averageLatencyNanos() const{
+        return this->completed==0?0: static_cast<double>(this->totalLatencyNanos)/ this->completed;
+    }
+
+    ~CoffeePipeline(){
+        close();
+    }
+};
+
+//用法：模板方法模式 [--pipeline | --virtual]
+int main(int argc, char* argv[]) {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
     int coffeeType;
-    unique_ptr<CoffeeMakeSystem> coffeemaker;
+    string option=argc>1?argv[1]:"";
+    if (option=="--pipeline"){
+        CoffeePipeline pipeline;
+        while (cin>>coffeeType){
+            pipeline.submit(coffeeType);
+        }
+        pipeline.close();
+        return 0;
+    }
+    if (option=="--virtual"){
+        //虚函数版本：咖啡机同样只创建一次，通过基类指针分派
+        AmericanCoffee americanCoffee;
+        LatteCoffeeMaker latteCoffee;
+        CoffeeMakeSystem* makers[]={nullptr, &americanCoffee, &latteCoffee};
+        while (cin>>coffeeType){
+            if (coffeeType==1||coffeeType==2){
+                makers[coffeeType]->makeCoffee();
+            }else{
+                cout<<"Invalid coffee type"<<'\n';
+            }
+        }
+        return 0;
+    }
+    //咖啡机只创建一次，在所有订单间复用
+    StaticAmericanCoffee americanCoffee;
+    StaticLatteCoffeeMaker latteCoffee;
     while (cin>>coffeeType){
         if (coffeeType==1){
-            coffeemaker = make_unique<AmericanCoffee>();
+            americanCoffee.makeCoffee();
         }else if (coffeeType==2){
-            coffeemaker = make_unique<LatteCoffeeMaker>();
+            latteCoffee.makeCoffee();
         }else{
-            cout<<"Invalid coffee type"<<endl;
-            continue;
+            cout<<"Invalid coffee type"<<'\n';
         }
-        coffeemaker->makeCoffee();
     }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,139 @@
+/* 模板方法模式的基准：
+ * 默认：单订单开销，对比虚函数版本每单make_unique新建咖啡机、虚函数版本复用咖啡机、CRTP版本复用咖啡机三种做法。
+ *   输出写入一个丢弃数据的streambuf，只测模板方法本身与格式化的开销。
+ * pipeline：每阶段额外耗时从0到100us变化时，三阶段流水线与串行执行的吞吐和单订单延迟。
+ *   spin为忙等（计算型阶段，流水线需要至少4个核才能并行），sleep为睡眠（等待设备，单核上也能重叠）。
+ *   流水线延迟取averageLatencyNanos（提交到写出）；串行延迟为单个订单从开始到做完的时间。
+ * 编译：g++ -std=c++17 -O2 -pthread 模板方法模式_benchmark.cpp
+ * 用法：模板方法模式_benchmark [订单数，默认2e7]
+ *       模板方法模式_benchmark pipeline [spin|sleep]
+ */
+//复用模式程序中的类，程序自己的main改名后不使用
+#define main templateMethodProgramMain
+#include "模板方法模式.cpp"
+#undef main
+
+#include <cstdio>
+#include <cstdlib>
+
+//丢弃所有写入的数据
+class NullBuffer:public streambuf{
+protected:
+    int overflow(int c) override{
+        return c;
+    }
+
+    streamsize xsputn(const char*, streamsize n) override{
+        return n;
+    }
+};
+
+using BenchClock=chrono::steady_clock;
+
+template<typename Body>
+double nanosPerOrder(long long orders, Body body){
+    auto start=BenchClock::now();
+    for(long long i=0;i<orders;++i){
+        body(static_cast<int>(i&1)+1);
+    }
+    return chrono::duration<double, nano>(BenchClock::now()-start).count()/orders;
+}
+
+//每阶段耗时为stageNanos时串行与流水线各做一批订单
+void comparePipeline(long long stageNanos, bool blocking, ostream& nullStream){
+    CoffeePipeline::StageCost cost{chrono::nanoseconds(stageNanos), blocking};
+    //总耗时控制在一秒左右
+    long long orders=stageNanos==0?1000000:max(1000LL, 300000000LL/(3*stageNanos));
+
+    StaticAmericanCoffee americanCoffee;
+    StaticLatteCoffeeMaker latteCoffee;
+    double serialLatency=0;
+    auto start=BenchClock::now();
+    for(long long i=0;i<orders;++i){
+        auto orderStart=BenchClock::now();
+        if(i&1){
+            latteCoffee.grindStage(nullStream);
+            cost.spend();
+            latteCoffee.brewStage(nullStream);
+            cost.spend();
+            latteCoffee.condimentStage(nullStream);
+        }else{
+            americanCoffee.grindStage(nullStream);
+            cost.spend();
+            americanCoffee.brewStage(nullStream);
+            cost.spend();
+            americanCoffee.condimentStage(nullStream);
+        }
+        cost.spend();
+        serialLatency+=chrono::duration<double, nano>(BenchClock::now()-orderStart).count();
+    }
+    double serialSeconds=chrono::duration<double>(BenchClock::now()-start).count();
+
+    start=BenchClock::now();
+    CoffeePipeline pipeline(nullStream, cost);
+    for(long long i=0;i<orders;++i){
+        pipeline.submit(static_cast<int>(i&1)+1);
+    }
+    pipeline.close();
+    double pipelineSeconds=chrono::duration<double>(BenchClock::now()-start).count();
+
+    printf("%8lld ns/stage %8lld orders  serial %10.0f orders/s %10.0f ns latency  pipeline %10.0f orders/s %10.0f ns latency\n",
+           stageNanos, orders, orders/serialSeconds, serialLatency/orders, orders/pipelineSeconds,
+           pipeline.averageLatencyNanos());
+}
+
+int main(int argc, char* argv[]){
+    string mode=argc>1?argv[1]:"";
+    if(mode=="pipeline"){
+        string kind=argc>2?argv[2]:"spin";
+        if(kind!="spin"&&kind!="sleep"){
+            fprintf(stderr, "usage: 模板方法模式_benchmark pipeline [spin|sleep]\n");
+            return 2;
+        }
+        NullBuffer nullBuffer;
+        ostream nullStream(&nullBuffer);
+        printf("stage cost: %s, %u hardware threads\n", kind.c_str(), thread::hardware_concurrency());
+        for(long long stageNanos: {0LL, 1000LL, 10000LL, 100000LL}){
+            comparePipeline(stageNanos, kind=="sleep", nullStream);
+        }
+        return 0;
+    }
+    long long orders=argc>1?atoll(argv[1]):20000000;
+    NullBuffer nullBuffer;
+    ostream nullStream(&nullBuffer);
+    streambuf* saved=cout.rdbuf(&nullBuffer);
+
+    double perOrderAllocation=nanosPerOrder(orders, [](int coffeeType){
+        unique_ptr<CoffeeMakeSystem> coffeemaker;
+        if(coffeeType==1){
+            coffeemaker=make_unique<AmericanCoffee>();
+        }else{
+            coffeemaker=make_unique<LatteCoffeeMaker>();
+        }
+        coffeemaker->makeCoffee();
+    });
+
+    AmericanCoffee americanCoffee;
+    LatteCoffeeMaker latteCoffee;
+    CoffeeMakeSystem* makers[]={nullptr, &americanCoffee, &latteCoffee};
+    double reusedVirtual=nanosPerOrder(orders, [&](int coffeeType){
+        makers[coffeeType]->makeCoffee();
+    });
+
+    StaticAmericanCoffee staticAmerican;
+    StaticLatteCoffeeMaker staticLatte;
+    double reusedStatic=nanosPerOrder(orders, [&](int coffeeType){
+        if(coffeeType==1){
+            staticAmerican.makeCoffee(nullStream);
+        }else{
+            staticLatte.makeCoffee(nullStream);
+        }
+    });
+
+    cout.rdbuf(saved);
+    cout<<orders<<" orders, ns/order"<<'\n';
+    cout<<"virtual, make_unique per order: "<<perOrderAllocation<<'\n';
+    cout<<"virtual, reused makers:         "<<reusedVirtual<<'\n';
+    cout<<"CRTP, reused makers:            "<<reusedStatic<<'\n';
+    return 0;
+}
@@ -1,6 +1,19 @@
 #include<iostream>
 #include<string>
 #include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#if defined(__x86_64__)||defined(__i386__)
+#include <x86intrin.h>
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
@@ -26,58 +39,350 @@ public:
 class OnState:public State{
 public:
     void operation() override{
-        cout<< "Light is ON"<<endl;
+        cout<< "Light is ON"<<'\n';
     }
 };
 class OffState:public State{
 public:
     void operation() override{
-        cout<< "Light is OFF"<<endl;
+        cout<< "Light is OFF"<<'\n';
     }
 };
 class BlinkState:public State{
 public:
     void operation() override{
-        cout<< "Light is Blinking"<<endl;
+        cout<< "Light is Blinking"<<'\n';
     }
 };
 
-//上下文类
-class Light{
+/* 表驱动的状态机：具体状态类都不含数据，因此每种状态只需一个共享的单例对象；
+ * 状态转换由编译期(constexpr)生成的转换表给出，一次转换只是一次查表，不再new/delete状态对象。
+ */
+enum class LightState : uint8_t {
+    Off, On, Blink, Count
+};
+
+enum class LightEvent : uint8_t {
+    TurnOn, TurnOff, Blink, Count
+};
+
+constexpr size_t lightStateCount=static_cast<size_t>(LightState::Count);
+constexpr size_t lightEventCount=static_cast<size_t>(LightEvent::Count);
+
+//转换表：next[当前状态][事件]=下一个状态
+struct LightTransitionTable{
+    LightState next[lightStateCount][lightEventCount];
+};
+
+constexpr LightTransitionTable buildLightTransitions(){
+    LightTransitionTable table{};
+    for(size_t state=0;state<lightStateCount;++state){
+        //台灯的下一个状态只取决于按下的按钮，与当前状态无关
+        table.next[state][static_cast<size_t>(LightEvent::TurnOn)]=LightState::On;
+        table.next[state][static_cast<size_t>(LightEvent::TurnOff)]=LightState::Off;
+        table.next[state][static_cast<size_t>(LightEvent::Blink)]=LightState::Blink;
+    }
+    return table;
+}
+
+constexpr LightTransitionTable lightTransitions=buildLightTransitions();
+
+//共享的状态单例，按LightState的顺序排列
+OffState offState;
+OnState onState;
+BlinkState blinkState;
+constexpr State* lightStates[lightStateCount]={&offState, &onState, &blinkState};
+
+//把输入的指令解析为事件，无法识别时返回false
+bool parseLightEvent(const string& order, LightEvent& event){
+    if (order=="ON"){
+        event=LightEvent::TurnOn;
+    }else if (order=="OFF"){
+        event=LightEvent::TurnOff;
+    }else if(order=="BLINK"){
+        event=LightEvent::Blink;
+    }else {
+        return false;
+    }
+    return true;
+}
+
+/* 状态机观测：上下文类通过模板参数Tracer在每次转换时回调tracer.onTransition(前状态, 事件, 后状态)。
+ * NullLightTracer是空实现，内联后不产生任何代码，即“编译期关闭”；
+ * LightTracer精确统计每种(前状态, 后状态)转换的次数，并记录每个状态停留时长的对数直方图，
+ * 还可选地把每次转换写入一个定长的二进制环形缓冲区，事后一次导出。
+ * 读时间戳计数器(x86上为rdtsc)本身就比一次转换还贵，因此停留时长是抽样的：
+ * 每samplePeriod次转换计时一次，只测量这一次进入的状态停留了多久，直方图反映的是停留时长的分布。
+ * 轨迹记录中的时间戳是最近一次抽样的时刻，精确的先后顺序由序号给出。
+ * 编译时定义LIGHT_TRACE即可让默认的Light带上LightTracer，统计结果输出到标准错误。
+ */
+class NullLightTracer{
+public:
+    void onTransition(LightState, LightEvent, LightState){}
+};
+
+class LightTracer{
+public:
+    static constexpr int bucketCount=48;
+
+    //环形缓冲区中的一条转换记录，16字节
+    struct TraceRecord{
+        uint64_t timestamp;//最近一次抽样时的计数器值
+        uint32_t sequence;
+        uint8_t from;
+        uint8_t event;
+        uint8_t to;
+        uint8_t padding;
+    };
+private:
+    uint64_t transitions[lightStateCount][lightStateCount]{};
+    uint64_t dwellHistogram[lightStateCount][bucketCount]{};
+    uint64_t sampleMask;
+    uint64_t sequence=0;
+    bool timing=false;
+    uint64_t enteredAt=0;
+    uint64_t lastTicks;
+    uint64_t startTicks;
+    chrono::steady_clock::time_point startTime;
+    unique_ptr<TraceRecord[]> ring;//未开启轨迹时为空，热路径上只检查这一个指针
+    size_t ringMask=0;
+    uint64_t traceStart=0;//开启轨迹时的序号，已记录条数为sequence-traceStart
+
+    static uint64_t ticks(){
+#if defined(__x86_64__)||defined(__i386__)
+        return __rdtsc();
+#else
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    //每纳秒对应的计数器刻度，按构造以来的墙钟时间校准
+    double ticksPerNano() const{
+        double nanos=chrono::duration<double, nano>(chrono::steady_clock::now()- this->startTime).count();
+        return nanos>0?(ticks()- this->startTicks)/nanos:1.0;
+    }
+public:
+    //samplePeriod会向上取整为2的幂
+    explicit LightTracer(uint64_t samplePeriod=64)
+            :lastTicks(ticks()), startTicks(lastTicks), startTime(chrono::steady_clock::now()){
+        uint64_t period=1;
+        while(period<samplePeriod){
+            period<<=1;
+        }
+        this->sampleMask=period-1;
+    }
+
+    //开启二进制轨迹记录，只保留最近的capacity条（向上取整为2的幂）
+    void enableTrace(size_t capacity){
+        size_t size=1;
+        while(size<capacity){
+            size<<=1;
+        }
+        this->ring=make_unique<TraceRecord[]>(size);
+        this->ringMask=size-1;
+        this->traceStart= this->sequence;
+    }
+
+    void onTransition(LightState from, LightEvent event, LightState to){
+        ++this->transitions[static_cast<size_t>(from)][static_cast<size_t>(to)];
+        bool sample=(this->sequence& this->sampleMask)==0;
+        if(this->timing||sample){
+            uint64_t now=ticks();
+            if(this->timing){
+                //上一次抽样进入的状态（即from）到此结束
+                uint64_t dwell=now- this->enteredAt;
+                int bucket=dwell==0?0:64-__builtin_clzll(dwell);
+                ++this->dwellHistogram[static_cast<size_t>(from)][bucket<bucketCount?bucket:bucketCount-1];
+            }
+            this->timing=sample;
+            this->enteredAt=now;
+            this->lastTicks=now;
+        }
+        if(this->ring){
+            //整条记录先拼好再一次写入
+            this->ring[this->sequence& this->ringMask]=TraceRecord{this->lastTicks, static_cast<uint32_t>(this->sequence),
+                    static_cast<uint8_t>(from), static_cast<uint8_t>(event), static_cast<uint8_t>(to), 0};
+        }
+        ++this->sequence;
+    }
+
+    uint64_t transitionCount(LightState from, LightState to) const{
+        return this->transitions[static_cast<size_t>(from)][static_cast<size_t>(to)];
+    }
+
+    //按时间顺序把环形缓冲区中保留的记录以二进制写出，返回写出的条数
+    size_t dumpTrace(ostream& out) const{
+        if(!this->ring){
+            return 0;
+        }
+        uint64_t kept=min<uint64_t>(this->sequence- this->traceStart, this->ringMask+1);
+        for(uint64_t i= this->sequence-kept;i< this->sequence;++i){
+            out.write(reinterpret_cast<const char*>(&this->ring[i& this->ringMask]), sizeof(TraceRecord));
+        }
+        return kept;
+    }
+
+    void report(ostream& out) const{
+        static const char* names[lightStateCount]={"OFF", "ON", "BLINK"};
+        double scale=ticksPerNano();
+        out<<"transitions:"<<'\n';
+        for(size_t from=0;from<lightStateCount;++from){
+            for(size_t to=0;to<lightStateCount;++to){
+                if(this->transitions[from][to]!=0){
+                    out<<"  "<<names[from]<<" -> "<<names[to]<<": "<< this->transitions[from][to]<<'\n';
+                }
+            }
+        }
+        out<<"sampled dwell time (ns, upper bound of log2 bucket):"<<'\n';
+        for(size_t state=0;state<lightStateCount;++state){
+            for(int bucket=0;bucket<bucketCount;++bucket){
+                if(this->dwellHistogram[state][bucket]!=0){
+                    out<<"  "<<names[state]<<" <="<<static_cast<uint64_t>((uint64_t{1}<<bucket)/scale)
+                       <<": "<< this->dwellHistogram[state][bucket]<<'\n';
+                }
+            }
+        }
+    }
+};
+
+//上下文类：私有继承Tracer而不是把它作为成员，空的NullLightTracer借助空基类优化不占任何空间
+template<typename Tracer>
+class BasicLight:private Tracer{
+private:
+    LightState currentState=LightState::Off;//台灯初始状态是关闭的
+public:
+    void operate(LightEvent event){
+        LightState previous= this->currentState;
+        this->currentState=lightTransitions.next[static_cast<size_t>(previous)][static_cast<size_t>(event)];
+        getTracer().onTransition(previous, event, this->currentState);
+        lightStates[static_cast<size_t>(this->currentState)]->operation();
+    }
+
+    LightState getState() const{
+        return this->currentState;
+    }
+
+    Tracer& getTracer(){
+        return static_cast<Tracer&>(*this);
+    }
+};
+
+static_assert(sizeof(BasicLight<NullLightTracer>)==sizeof(LightState), "compiled-out tracing must not grow Light");
+
+#ifdef LIGHT_TRACE
+using Light=BasicLight<LightTracer>;
+#else
+using Light=BasicLight<NullLightTracer>;
+#endif
+
+static_assert(lightStateCount<=16, "broadcast lookup tables hold at most 16 states");
+
+//按事件展开的广播查找表：next[事件][当前状态]=下一个状态，每行补齐到16字节供SIMD重排使用
+struct LightBroadcastTables{
+    alignas(16) uint8_t next[lightEventCount][16];
+};
+
+constexpr LightBroadcastTables buildLightBroadcastTables(){
+    LightBroadcastTables tables{};
+    for(size_t event=0;event<lightEventCount;++event){
+        for(size_t state=0;state<lightStateCount;++state){
+            tables.next[event][state]=static_cast<uint8_t>(lightTransitions.next[state][event]);
+        }
+    }
+    return tables;
+}
+
+constexpr LightBroadcastTables lightBroadcastTables=buildLightBroadcastTables();
+
+/* 批量状态机：管理大量台灯时，不再让每个实例持有一个状态对象，
+ * 而是把所有实例的状态存成一个紧凑的字节数组（每个实例1字节），按批应用事件：
+ * broadcast()把同一个事件施加到全部实例，此时“下一个状态”只取决于当前状态，
+ * 是一张最多16项的字节查找表，可用SIMD字节重排(pshufb)一次查16个实例；
+ * 没有SSSE3时用SSE2的逐状态比较+选择，非x86平台退化为逐字节查表。
+ * apply()按(实例, 事件)数组依次应用，同一批中对同一实例的多个事件按数组顺序生效。
+ * 批量模式只更新状态，不调用各状态的operation()输出。
+ */
+class LightFleet{
 private:
-    State* currentState;
+    vector<uint8_t> states;
 public:
-    Light():currentState(new OffState()){}//台灯初始状态是关闭的
-    void operate(State* newState){
-        delete this->currentState;
-        this->currentState=newState;
-        this->currentState->operation();
+    explicit LightFleet(size_t count):states(count, static_cast<uint8_t>(LightState::Off)){}
+
+    size_t size() const{
+        return this->states.size();
+    }
+
+    LightState getState(size_t instance) const{
+        return static_cast<LightState>(this->states[instance]);
+    }
+
+    size_t countInState(LightState state) const{
+        return count(this->states.begin(), this->states.end(), static_cast<uint8_t>(state));
+    }
+
+    void broadcast(LightEvent event){
+        const uint8_t* table=lightBroadcastTables.next[static_cast<size_t>(event)];
+        uint8_t* data= this->states.data();
+        size_t n= this->states.size();
+        size_t i=0;
+#if defined(__SSSE3__)
+        const __m128i lut=_mm_load_si128(reinterpret_cast<const __m128i*>(table));
+        for(;i+16<=n;i+=16){
+            __m128i current=_mm_loadu_si128(reinterpret_cast<const __m128i*>(data+i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data+i), _mm_shuffle_epi8(lut, current));
+        }
+#elif defined(__SSE2__)
+        for(;i+16<=n;i+=16){
+            __m128i current=_mm_loadu_si128(reinterpret_cast<const __m128i*>(data+i));
+            __m128i next=_mm_setzero_si128();
+            for(size_t state=0;state<lightStateCount;++state){
+                __m128i match=_mm_cmpeq_epi8(current, _mm_set1_epi8(static_cast<char>(state)));
+                next=_mm_or_si128(next, _mm_and_si128(match, _mm_set1_epi8(static_cast<char>(table[state]))));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data+i), next);
+        }
+#endif
+        for(;i<n;++i){
+            data[i]=table[data[i]];
+        }
+    }
+
+    void apply(const uint32_t* instances, const LightEvent* events, size_t count){
+        uint8_t* data= this->states.data();
+        constexpr size_t prefetchDistance=16;
+        for(size_t i=0;i<count;++i){
+            if(i+prefetchDistance<count){
+                //实例下标是随机的，提前把后面要访问的状态字节所在的缓存行取进来
+                __builtin_prefetch(data+instances[i+prefetchDistance], 1);
+            }
+            uint8_t& state=data[instances[i]];
+            state=static_cast<uint8_t>(lightTransitions.next[state][static_cast<size_t>(events[i])]);
+        }
     }
-//    void operate(){
-//        this->currentState->operation();
-//    }
 
-    ~Light(){
-        delete currentState;
+    void apply(const vector<uint32_t>& instances, const vector<LightEvent>& events){
+        apply(instances.data(), events.data(), min(instances.size(), events.size()));
     }
 };
 
 int main() {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
     int quantity;
     cin >> quantity;
     Light light;
+    string order;
     while (quantity--) {
-        string order;
         cin>>order;
-        if (order=="ON"){
-            light.operate(new OnState());
-        }else if (order=="OFF"){
-            light.operate(new OffState());
-        }else if(order=="BLINK"){
-            light.operate(new BlinkState());
+        LightEvent event;
+        if (parseLightEvent(order, event)){
+            light.operate(event);
         }else {
-            cout<<"Invalid command:"<<order<<endl;
+            cout<<"Invalid command:"<<order<<'\n';
         }
     }
+#ifdef LIGHT_TRACE
+    light.getTracer().report(cerr);
+#endif
     return 0;
 }
\ No newline at end of file
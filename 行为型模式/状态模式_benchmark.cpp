@@ -0,0 +1,250 @@
+/* 状态模式的基准测试。
+ * transitions：随机事件序列下单个台灯每次转换的耗时，对比原来每次转换new一个具体状态、delete旧状态的做法
+ *   与表驱动的Light（共享状态单例+constexpr转换表）。两者都调用operation()输出，输出写入丢弃数据的streambuf。
+ * fleet：LightFleet在1e6与给定数量（默认1e8）个实例上的吞吐，单位为每秒转换次数。
+ *   broadcast对比编译进来的SIMD路径与逐字节查表；apply为1e7个随机(实例, 事件)。先与逐个实例的参考实现核对结果。
+ * trace：单个台灯每次转换的耗时，对比没有观测钩子的上下文、BasicLight<NullLightTracer>（编译期关闭）、
+ *   LightTracer（计数+抽样直方图）以及再开启65536条环形轨迹的LightTracer，各取9轮中的最好成绩（轮与轮之间交替运行，减少频率漂移的影响）。
+ * 编译：g++ -std=c++17 -O2 状态模式_benchmark.cpp（加-mssse3时broadcast使用pshufb，否则使用SSE2）
+ * 用法：状态模式_benchmark transitions [转换次数，默认1e8]
+ *       状态模式_benchmark fleet [最大实例数，默认1e8]
+ *       状态模式_benchmark trace [每轮转换次数，默认2e7]
+ */
+//复用模式程序中的类，程序自己的main改名后不使用
+#define main stateProgramMain
+#include "状态模式.cpp"
+#undef main
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+//丢弃所有写入的数据
+class NullBuffer:public streambuf{
+protected:
+    int overflow(int c) override{
+        return c;
+    }
+
+    streamsize xsputn(const char*, streamsize n) override{
+        return n;
+    }
+};
+
+using BenchClock=chrono::steady_clock;
+
+//原来的上下文类：每次转换接管一个新建的具体状态对象并删除旧的
+class AllocatingLight{
+private:
+    State* currentState;
+public:
+    AllocatingLight():currentState(new OffState()){}
+
+    AllocatingLight(const AllocatingLight&)=delete;
+    AllocatingLight& operator=(const AllocatingLight&)=delete;
+
+    void operate(State* newState){
+        delete this->currentState;
+        this->currentState=newState;
+        this->currentState->operation();
+    }
+
+    ~AllocatingLight(){
+        delete this->currentState;
+    }
+};
+
+//线性同余生成的事件序列，两种做法看到的事件完全相同，且生成开销远小于一次转换
+class EventSource{
+private:
+    uint32_t seed=1;
+public:
+    LightEvent next(){
+        this->seed= this->seed*1664525u+1013904223u;
+        return static_cast<LightEvent>((this->seed>>28)%lightEventCount);
+    }
+};
+
+template<typename Body>
+double nanosPerTransition(long long transitions, Body body){
+    EventSource events;
+    auto start=BenchClock::now();
+    for(long long i=0;i<transitions;++i){
+        body(events.next());
+    }
+    return chrono::duration<double, nano>(BenchClock::now()-start).count()/transitions;
+}
+
+void benchmarkTransitions(long long transitions){
+    NullBuffer nullBuffer;
+    streambuf* saved=cout.rdbuf(&nullBuffer);
+    AllocatingLight allocatingLight;
+    double allocating=nanosPerTransition(transitions, [&](LightEvent event){
+        if(event==LightEvent::TurnOn){
+            allocatingLight.operate(new OnState());
+        }else if(event==LightEvent::TurnOff){
+            allocatingLight.operate(new OffState());
+        }else{
+            allocatingLight.operate(new BlinkState());
+        }
+    });
+    Light light;
+    double table=nanosPerTransition(transitions, [&](LightEvent event){
+        light.operate(event);
+    });
+    cout.rdbuf(saved);
+    printf("%lld transitions, ns/transition\n", transitions);
+    printf("new/delete per transition: %6.2f\n", allocating);
+    printf("transition table:          %6.2f\n", table);
+}
+
+//broadcast的逐字节参考实现，即没有SIMD时LightFleet的尾部循环
+void scalarBroadcast(vector<uint8_t>& states, LightEvent event){
+    const uint8_t* table=lightBroadcastTables.next[static_cast<size_t>(event)];
+    for(uint8_t& state: states){
+        state=table[state];
+    }
+}
+
+const char* broadcastPath(){
+#if defined(__SSSE3__)
+    return "SSSE3 pshufb";
+#elif defined(__SSE2__)
+    return "SSE2 compare+select";
+#else
+    return "scalar";
+#endif
+}
+
+//随机混合broadcast与apply，和逐个实例用转换表推进的结果比较
+bool fleetMatchesReference(){
+    mt19937 rng(1);
+    const size_t count=1003;//不是16的倍数，覆盖尾部循环
+    LightFleet fleet(count);
+    vector<LightState> reference(count, LightState::Off);
+    for(int round=0;round<200;++round){
+        if(rng()%2){
+            auto event=static_cast<LightEvent>(rng()%lightEventCount);
+            fleet.broadcast(event);
+            for(LightState& state: reference){
+                state=lightTransitions.next[static_cast<size_t>(state)][static_cast<size_t>(event)];
+            }
+            continue;
+        }
+        vector<uint32_t> instances(500);
+        vector<LightEvent> events(500);
+        for(size_t k=0;k<instances.size();++k){
+            instances[k]=rng()%count;
+            events[k]=static_cast<LightEvent>(rng()%lightEventCount);
+            LightState& state=reference[instances[k]];
+            state=lightTransitions.next[static_cast<size_t>(state)][static_cast<size_t>(events[k])];
+        }
+        fleet.apply(instances, events);
+    }
+    for(size_t i=0;i<count;++i){
+        if(fleet.getState(i)!=reference[i]){
+            return false;
+        }
+    }
+    return true;
+}
+
+void benchmarkFleet(size_t largest){
+    if(!fleetMatchesReference()){
+        printf("fleet does not match the per-instance reference\n");
+        return;
+    }
+    printf("broadcast path: %s\n", broadcastPath());
+    for(size_t count: {size_t{1000000}, largest}){
+        //每轮扫过的字节数大致相同
+        int rounds=static_cast<int>(max<size_t>(3, 1000000000/count));
+        LightFleet fleet(count);
+        auto start=BenchClock::now();
+        for(int round=0;round<rounds;++round){
+            fleet.broadcast(static_cast<LightEvent>(round%lightEventCount));
+        }
+        double simdSeconds=chrono::duration<double>(BenchClock::now()-start).count();
+
+        vector<uint8_t> states(count, static_cast<uint8_t>(LightState::Off));
+        start=BenchClock::now();
+        for(int round=0;round<rounds;++round){
+            scalarBroadcast(states, static_cast<LightEvent>(round%lightEventCount));
+        }
+        double scalarSeconds=chrono::duration<double>(BenchClock::now()-start).count();
+        bool same=true;
+        for(size_t i=0;i<count;++i){
+            same=same&&fleet.getState(i)==static_cast<LightState>(states[i]);
+        }
+
+        const size_t batch=10000000;
+        mt19937 rng(2);
+        vector<uint32_t> instances(batch);
+        vector<LightEvent> events(batch);
+        for(size_t k=0;k<batch;++k){
+            instances[k]=static_cast<uint32_t>(rng()%count);
+            events[k]=static_cast<LightEvent>(rng()%lightEventCount);
+        }
+        start=BenchClock::now();
+        fleet.apply(instances, events);
+        double applySeconds=chrono::duration<double>(BenchClock::now()-start).count();
+
+        double transitions=static_cast<double>(count)*rounds;
+        printf("%10zu instances: broadcast %s %6.2f G/s, scalar %6.2f G/s%s; random apply %6.1f M/s\n", count,
+               broadcastPath(), transitions/simdSeconds/1e9, transitions/scalarSeconds/1e9,
+               same?"":" (MISMATCH)", batch/applySeconds/1e6);
+    }
+}
+
+//不带任何观测钩子的上下文，作为编译期关闭观测的对照
+class PlainLight{
+private:
+    LightState currentState=LightState::Off;
+public:
+    void operate(LightEvent event){
+        this->currentState=lightTransitions.next[static_cast<size_t>(this->currentState)][static_cast<size_t>(event)];
+        lightStates[static_cast<size_t>(this->currentState)]->operation();
+    }
+};
+
+void benchmarkTrace(long long transitions){
+    NullBuffer nullBuffer;
+    streambuf* saved=cout.rdbuf(&nullBuffer);
+    double plain=1e9, compiledOut=1e9, traced=1e9, ring=1e9;
+    for(int round=0;round<9;++round){
+        PlainLight plainLight;
+        BasicLight<NullLightTracer> nullLight;
+        BasicLight<LightTracer> tracedLight;
+        BasicLight<LightTracer> ringLight;
+        ringLight.getTracer().enableTrace(1<<16);
+        plain=min(plain, nanosPerTransition(transitions, [&](LightEvent event){ plainLight.operate(event); }));
+        compiledOut=min(compiledOut, nanosPerTransition(transitions, [&](LightEvent event){ nullLight.operate(event); }));
+        traced=min(traced, nanosPerTransition(transitions, [&](LightEvent event){ tracedLight.operate(event); }));
+        ring=min(ring, nanosPerTransition(transitions, [&](LightEvent event){ ringLight.operate(event); }));
+    }
+    cout.rdbuf(saved);
+    printf("%lld transitions per round, best of 9, ns/transition\n", transitions);
+    printf("no hook:                  %6.2f\n", plain);
+    printf("NullLightTracer:          %6.2f (%+.1f%%), sizeof %zu\n", compiledOut, (compiledOut/plain-1)*100,
+           sizeof(BasicLight<NullLightTracer>));
+    printf("LightTracer:              %6.2f (%+.1f%%)\n", traced, (traced/plain-1)*100);
+    printf("LightTracer + trace ring: %6.2f (%+.1f%%)\n", ring, (ring/plain-1)*100);
+}
+
+int main(int argc, char* argv[]){
+    string mode=argc>1?argv[1]:"";
+    long long count=argc>2?atoll(argv[2]):0;
+    if(mode=="transitions"){
+        benchmarkTransitions(count>0?count:100000000);
+        return 0;
+    }
+    if(mode=="fleet"){
+        benchmarkFleet(count>0?static_cast<size_t>(count):100000000);
+        return 0;
+    }
+    if(mode=="trace"){
+        benchmarkTrace(count>0?count:20000000);
+        return 0;
+    }
+    fprintf(stderr, "usage: 状态模式_benchmark transitions|fleet|trace [count]\n");
+    return 2;
+}
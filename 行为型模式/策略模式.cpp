@@ -1,6 +1,22 @@
 #include<iostream>
 #include<vector>
 #include <cmath>
+#include <cstddef>
+#include <variant>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <istream>
+#include <stdexcept>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
@@ -24,20 +40,64 @@ class DiscountStrategy {
 public:
     virtual int applyDiscount(int originalPrice) = 0;
 
+    // 批量计算：一次虚函数调用处理count个价格，结果与逐个调用applyDiscount逐位相同。
+    // 默认实现逐个调用，具体策略可以用向量化的实现重写
+    virtual void applyDiscountBatch(const int *in, int *out, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = applyDiscount(in[i]);
+        }
+    }
+
     virtual ~DiscountStrategy() = default;
 };
 
 // 九折优惠策略类
-class NineDiscount : public DiscountStrategy {
+class NineDiscount final : public DiscountStrategy {
 public:
     int applyDiscount(int originalPrice) override {
         // round()仅对小数点后一位四舍五入，即只保留整数位
         return static_cast<int>(round(originalPrice * 0.9));
     }
+
+    // 与round()逐位相同的向量化实现：乘法仍用double完成；
+    // x-trunc(x)是精确的，据此判断小数部分是否达到0.5，再向远离0的方向进1，即round()的舍入规则
+    void applyDiscountBatch(const int *in, int *out, size_t count) override {
+        size_t i = 0;
+#if defined(__SSE2__)
+        const __m128d factor = _mm_set1_pd(0.9);
+        const __m128d half = _mm_set1_pd(0.5);
+        const __m128d minusHalf = _mm_set1_pd(-0.5);
+        for (; i + 4 <= count; i += 4) {
+            __m128i prices = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+            __m128d lowValue = _mm_mul_pd(_mm_cvtepi32_pd(prices), factor);
+            __m128d highValue = _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(prices, _MM_SHUFFLE(1, 0, 3, 2))), factor);
+            __m128i lowTrunc = _mm_cvttpd_epi32(lowValue);
+            __m128i highTrunc = _mm_cvttpd_epi32(highValue);
+            __m128d lowFraction = _mm_sub_pd(lowValue, _mm_cvtepi32_pd(lowTrunc));
+            __m128d highFraction = _mm_sub_pd(highValue, _mm_cvtepi32_pd(highTrunc));
+            // 比较结果为全1(-1)或0，分别按“>=0.5则+1、<=-0.5则-1”修正
+            __m128i lowUp = _mm_castpd_si128(_mm_cmpge_pd(lowFraction, half));
+            __m128i lowDown = _mm_castpd_si128(_mm_cmple_pd(lowFraction, minusHalf));
+            __m128i highUp = _mm_castpd_si128(_mm_cmpge_pd(highFraction, half));
+            __m128i highDown = _mm_castpd_si128(_mm_cmple_pd(highFraction, minusHalf));
+            // 64位掩码的低32位与高32位相同，取偶数下标的32位并拼成4路
+            __m128i up = _mm_unpacklo_epi64(_mm_shuffle_epi32(lowUp, _MM_SHUFFLE(3, 1, 2, 0)),
+                                            _mm_shuffle_epi32(highUp, _MM_SHUFFLE(3, 1, 2, 0)));
+            __m128i down = _mm_unpacklo_epi64(_mm_shuffle_epi32(lowDown, _MM_SHUFFLE(3, 1, 2, 0)),
+                                              _mm_shuffle_epi32(highDown, _MM_SHUFFLE(3, 1, 2, 0)));
+            __m128i truncated = _mm_unpacklo_epi64(lowTrunc, highTrunc);
+            __m128i rounded = _mm_add_epi32(_mm_sub_epi32(truncated, up), down);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), rounded);
+        }
+#endif
+        for (; i < count; ++i) {
+            out[i] = applyDiscount(in[i]);
+        }
+    }
 };
 
 // 满减优惠策略类
-class subDiscount : public DiscountStrategy {
+class subDiscount final : public DiscountStrategy {
 private:
     int thresholds[4] = {100, 150, 200, 300};
     int discount[4] = {5, 15, 25, 40};
@@ -50,6 +110,186 @@ public:
         }
         return orinalPrice;
     }
+
+    // 无分支的门槛查找：thresholds升序排列，把“达到第k档”的比较结果(全1或0)与该档相对上一档多减的金额相与，
+    // 累加后就是应减金额，整个过程没有分支，SSE2下一次处理4个价格
+    void applyDiscountBatch(const int *in, int *out, size_t count) override {
+        int step[4];
+        for (int k = 0; k < 4; ++k) {
+            step[k] = this->discount[k] - (k == 0 ? 0 : this->discount[k - 1]);
+        }
+        size_t i = 0;
+#if defined(__SSE2__)
+        __m128i thresholdMinusOne[4];
+        __m128i stepVector[4];
+        for (int k = 0; k < 4; ++k) {
+            // price>=threshold 等价于 price>threshold-1
+            thresholdMinusOne[k] = _mm_set1_epi32(this->thresholds[k] - 1);
+            stepVector[k] = _mm_set1_epi32(step[k]);
+        }
+        for (; i + 4 <= count; i += 4) {
+            __m128i prices = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+            __m128i reduction = _mm_setzero_si128();
+            for (int k = 0; k < 4; ++k) {
+                __m128i reached = _mm_cmpgt_epi32(prices, thresholdMinusOne[k]);
+                reduction = _mm_add_epi32(reduction, _mm_and_si128(reached, stepVector[k]));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_sub_epi32(prices, reduction));
+        }
+#endif
+        for (; i < count; ++i) {
+            int reduction = 0;
+            for (int k = 0; k < 4; ++k) {
+                reduction += (in[i] >= this->thresholds[k]) ? step[k] : 0;
+            }
+            out[i] = in[i] - reduction;
+        }
+    }
+};
+
+/* 可运行时加载的分档满减表，编译成便于查找的形式：
+ * 对价格在[0, lutLimit)内的商品，使用一张稠密的“价格->减免金额”查找表(LUT)，一次访存即可得到结果；
+ * 超出该范围的价格，在按Eytzinger（二叉堆序）排列的门槛数组上做无分支的二分查找，
+ * 查找路径上的元素在内存中集中于数组前部，缓存命中率比有序数组上的std::upper_bound更高。
+ * 语义与subDiscount相同：减去不超过价格的最高一档门槛对应的金额，低于所有门槛时不减。
+ */
+class CompiledTierTable {
+private:
+    vector<int> lut;
+    vector<int> tree;          // Eytzinger排列的门槛，下标从1开始
+    vector<int> predecessor;   // predecessor[k]：有序序列中排在tree[k]之前那一档的减免金额
+    int topDiscount = 0;       // 价格不低于最高门槛时的减免金额
+    size_t size = 0;
+
+    void layout(const vector<pair<int, int>> &brackets, size_t &next, size_t k) {
+        if (k > this->size) {
+            return;
+        }
+        layout(brackets, next, 2 * k);
+        this->tree[k] = brackets[next].first;
+        this->predecessor[k] = next == 0 ? 0 : brackets[next - 1].second;
+        ++next;
+        layout(brackets, next, 2 * k + 1);
+    }
+public:
+    // brackets为(门槛, 减免金额)，无需事先排序；lutLimit为0时不建查找表
+    CompiledTierTable(vector<pair<int, int>> brackets, int lutLimit) {
+        sort(brackets.begin(), brackets.end());
+        this->size = brackets.size();
+        this->tree.assign(this->size + 1, 0);
+        this->predecessor.assign(this->size + 1, 0);
+        size_t next = 0;
+        layout(brackets, next, 1);
+        this->topDiscount = this->size == 0 ? 0 : brackets.back().second;
+
+        this->lut.assign(static_cast<size_t>(max(lutLimit, 0)), 0);
+        size_t bracket = 0;
+        int current = 0;
+        for (size_t price = 0; price < this->lut.size(); ++price) {
+            while (bracket < brackets.size() && brackets[bracket].first <= static_cast<int>(price)) {
+                current = brackets[bracket++].second;
+            }
+            this->lut[price] = current;
+        }
+    }
+
+    int discountFor(int price) const {
+        if (static_cast<size_t>(price) < this->lut.size()) {
+            return this->lut[price];
+        }
+        // 无分支下降：走到叶子之后，去掉末尾因“向右走”而追加的1，即得到第一个大于price的门槛的位置
+        size_t k = 1;
+        while (k <= this->size) {
+            k = 2 * k + (this->tree[k] <= price);
+        }
+        k >>= __builtin_ffsll(~static_cast<long long>(k));
+        return k == 0 ? this->topDiscount : this->predecessor[k];
+    }
+};
+
+// 分档满减策略：档位表可在运行时整体替换。
+// 替换时先在调用线程上编译好新表，再用一次原子存储发布；正在定价的线程继续使用它们已经取得的旧表，
+// 旧表在最后一个使用者释放后自动回收。批量定价每批只读取一次当前表。
+// libstdc++的shared_ptr原子读取要经过一把全局的锁表互斥量，不能每件商品读一次：
+// 每次替换都分配一个全局唯一的版本号，逐件定价时各线程缓存自己取得的表及其版本号，
+// 只读一次原子的版本号确认没有变化，变了才重新读取表。需要长时间定价的调用者也可以用snapshot()自己持有一份。
+// 线程的缓存按实例地址分成若干槽，交替使用几个实例时不会互相挤掉；
+// 版本号全局唯一，即使槽被别的实例占用或实例地址被复用，也不会取到别的实例的表。
+class TieredDiscount final : public DiscountStrategy {
+private:
+    struct CachedTable {
+        const TieredDiscount *owner = nullptr;
+        uint64_t version = 0;
+        shared_ptr<const CompiledTierTable> table;
+    };
+
+    static constexpr size_t cacheSlots = 8;
+
+    static uint64_t nextVersion() {
+        static atomic<uint64_t> counter{0};
+        return counter.fetch_add(1, memory_order_relaxed) + 1;
+    }
+
+    shared_ptr<const CompiledTierTable> table;
+    atomic<uint64_t> version;
+
+    const CompiledTierTable &current() {
+        static thread_local CachedTable cache[cacheSlots];
+        CachedTable &cached = cache[(reinterpret_cast<uintptr_t>(this) / alignof(TieredDiscount)) % cacheSlots];
+        uint64_t latest = this->version.load(memory_order_acquire);
+        if (cached.owner != this || cached.version != latest) {
+            cached.table = atomic_load(&this->table);
+            cached.owner = this;
+            cached.version = latest;
+        }
+        return *cached.table;
+    }
+public:
+    explicit TieredDiscount(const vector<pair<int, int>> &brackets, int lutLimit = 1 << 16)
+            : table(make_shared<const CompiledTierTable>(brackets, lutLimit)), version(nextVersion()) {}
+
+    // 从输入流读取若干行“门槛 减免金额”，读到流末尾为止。
+    // 缺了减免金额的半行或读不成整数的内容都使整份输入无效，抛出invalid_argument，而不是悄悄截断档位表
+    static vector<pair<int, int>> readBrackets(istream &in) {
+        vector<pair<int, int>> brackets;
+        int threshold, discount;
+        while (in >> threshold) {
+            if (!(in >> discount)) {
+                throw invalid_argument("bracket list: threshold without a discount");
+            }
+            brackets.emplace_back(threshold, discount);
+        }
+        if (!in.eof()) {
+            throw invalid_argument("bracket list: malformed input");
+        }
+        return brackets;
+    }
+
+    void loadBrackets(const vector<pair<int, int>> &brackets, int lutLimit = 1 << 16) {
+        atomic_store(&this->table, shared_ptr<const CompiledTierTable>(make_shared<const CompiledTierTable>(brackets, lutLimit)));
+        this->version.store(nextVersion(), memory_order_release);
+    }
+
+    // 从输入流读取并替换当前档位表；输入无效时抛出异常，当前表保持不变
+    void loadBrackets(istream &in, int lutLimit = 1 << 16) {
+        loadBrackets(readBrackets(in), lutLimit);
+    }
+
+    // 当前档位表的一份快照，持有期间不受替换影响
+    shared_ptr<const CompiledTierTable> snapshot() const {
+        return atomic_load(&this->table);
+    }
+
+    int applyDiscount(int originalPrice) override {
+        return originalPrice - current().discountFor(originalPrice);
+    }
+
+    void applyDiscountBatch(const int *in, int *out, size_t count) override {
+        shared_ptr<const CompiledTierTable> current = snapshot();
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = in[i] - current->discountFor(in[i]);
+        }
+    }
 };
 
 // 上下文类，即需要调用策略的对象
@@ -66,36 +306,238 @@ public:
     }
 };
 
-int main() {
+/* 策略注册表：具体策略都是无状态的，每种只需一个实例，按编号（1=九折，2=满减）取用，不再每件商品new一个。
+ * 实例存放在std::variant中，通过std::visit分派到具体类型；具体策略类是final的，调用可以去虚化。
+ * applyGrouped()先按策略编号对商品做计数排序，把同一策略的价格收集到连续的缓冲区，
+ * 每组只分派一次并调用批量接口，再按原下标写回结果。排序用的缓冲区在多次调用间复用。
+ */
+class DiscountRegistry {
+public:
+    using Strategy = variant<NineDiscount, subDiscount>;
+private:
+    vector<Strategy> strategies;
+    vector<size_t> groupStart;
+    vector<size_t> order;
+    vector<int> groupedPrices;
+    vector<int> groupedResults;
+public:
+    DiscountRegistry() {
+        this->strategies.emplace_back(in_place_type<NineDiscount>);
+        this->strategies.emplace_back(in_place_type<subDiscount>);
+    }
+
+    bool contains(int id) const {
+        return id >= 1 && id <= static_cast<int>(this->strategies.size());
+    }
+
+    int applyDiscount(int id, int originalPrice) {
+        return visit([originalPrice](auto &strategy) { return strategy.applyDiscount(originalPrice); },
+                     this->strategies[id - 1]);
+    }
+
+    // ids中的编号须已通过contains()检查
+    void applyGrouped(const vector<int> &prices, const vector<int> &ids, vector<int> &out) {
+        out.resize(prices.size());
+        applyGrouped(prices.data(), ids.data(), out.data(), prices.size());
+    }
+
+    void applyGrouped(const int *prices, const int *ids, int *out, size_t n) {
+        size_t groups = this->strategies.size();
+        //计数排序：先统计后做前缀和，groupStart[id]即编号为id的组的结束位置
+        this->groupStart.assign(groups + 1, 0);
+        for (size_t i = 0; i < n; ++i) {
+            ++this->groupStart[ids[i]];
+        }
+        for (size_t id = 1; id <= groups; ++id) {
+            this->groupStart[id] += this->groupStart[id - 1];
+        }
+        this->order.resize(n);
+        this->groupedPrices.resize(n);
+        this->groupedResults.resize(n);
+        //倒序放置，组内保持原顺序；放置完成后groupStart[id]变成编号为id的组的起始位置
+        for (size_t i = n; i-- > 0;) {
+            size_t slot = --this->groupStart[ids[i]];
+            this->order[slot] = i;
+            this->groupedPrices[slot] = prices[i];
+        }
+        for (size_t id = 1; id <= groups; ++id) {
+            size_t begin = this->groupStart[id];
+            size_t end = id < groups ? this->groupStart[id + 1] : n;
+            if (begin == end) {
+                continue;
+            }
+            visit([&](auto &strategy) {
+                strategy.applyDiscountBatch(this->groupedPrices.data() + begin, this->groupedResults.data() + begin, end - begin);
+            }, this->strategies[id - 1]);
+        }
+        for (size_t slot = 0; slot < n; ++slot) {
+            out[this->order[slot]] = this->groupedResults[slot];
+        }
+    }
+};
+
+/* 并行重新定价：输入按chunkSize切块，由一个常驻线程池处理，调用者线程也参与计算。
+ * 每个线程先领到一段连续的块区间，用原子计数器从区间头部逐块认领；
+ * 自己的区间做完后，再按顺序到其他线程的区间里用同一个计数器“偷”块，负载不均时也能一起做完。
+ * 每块的结果直接写回该块在输出中的位置，因此输出顺序与串行完全相同，与线程数和调度无关。
+ * 每个线程有自己的DiscountRegistry（其中的分组缓冲区不能共享）。
+ */
+class ParallelRepricer {
+private:
+    struct Worker {
+        alignas(64) atomic<size_t> next{0};
+        size_t end = 0;
+        DiscountRegistry registry;
+    };
+
+    vector<unique_ptr<Worker>> workers;
+    vector<thread> threads;
+    mutex lock;
+    condition_variable wake;
+    condition_variable finished;
+    uint64_t generation = 0;
+    size_t running = 0;
+    bool stopping = false;
+
+    // 当前任务
+    const int *prices = nullptr;
+    const int *ids = nullptr;
+    int *out = nullptr;
+    size_t count = 0;
+    size_t chunkSize = 0;
+
+    void runChunks(size_t self) {
+        size_t n = this->workers.size();
+        DiscountRegistry &registry = this->workers[self]->registry;
+        for (size_t k = 0; k < n; ++k) {
+            Worker &victim = *this->workers[(self + k) % n];
+            while (true) {
+                size_t chunk = victim.next.fetch_add(1, memory_order_relaxed);
+                if (chunk >= victim.end) {
+                    break;
+                }
+                size_t begin = chunk * this->chunkSize;
+                size_t size = min(this->chunkSize, this->count - begin);
+                registry.applyGrouped(this->prices + begin, this->ids + begin, this->out + begin, size);
+            }
+        }
+    }
+
+    void workerLoop(size_t self) {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                unique_lock<mutex> guard(this->lock);
+                this->wake.wait(guard, [&] { return this->stopping || this->generation != seen; });
+                if (this->stopping) {
+                    return;
+                }
+                seen = this->generation;
+            }
+            runChunks(self);
+            lock_guard<mutex> guard(this->lock);
+            if (--this->running == 0) {
+                this->finished.notify_one();
+            }
+        }
+    }
+public:
+    explicit ParallelRepricer(size_t threadCount) {
+        threadCount = max<size_t>(threadCount, 1);
+        for (size_t i = 0; i < threadCount; ++i) {
+            this->workers.emplace_back(make_unique<Worker>());
+        }
+        // 0号由调用者线程担任
+        for (size_t i = 1; i < threadCount; ++i) {
+            this->threads.emplace_back([this, i] { workerLoop(i); });
+        }
+    }
+
+    ParallelRepricer(const ParallelRepricer &) = delete;
+    ParallelRepricer &operator=(const ParallelRepricer &) = delete;
+
+    size_t threadCount() const {
+        return this->workers.size();
+    }
+
+    // ids中的编号须已通过DiscountRegistry::contains()检查；chunkSize为0时按1处理
+    void reprice(const vector<int> &prices, const vector<int> &ids, vector<int> &out, size_t chunkSize = 1 << 16) {
+        chunkSize = max<size_t>(chunkSize, 1);
+        out.resize(prices.size());
+        size_t chunks = (prices.size() + chunkSize - 1) / chunkSize;
+        size_t n = this->workers.size();
+        {
+            lock_guard<mutex> guard(this->lock);
+            this->prices = prices.data();
+            this->ids = ids.data();
+            this->out = out.data();
+            this->count = prices.size();
+            this->chunkSize = chunkSize;
+            for (size_t w = 0; w < n; ++w) {
+                this->workers[w]->next.store(chunks * w / n, memory_order_relaxed);
+                this->workers[w]->end = chunks * (w + 1) / n;
+            }
+            this->running = n - 1;
+            ++this->generation;
+        }
+        this->wake.notify_all();
+        runChunks(0);
+        unique_lock<mutex> guard(this->lock);
+        this->finished.wait(guard, [this] { return this->running == 0; });
+    }
+
+    ~ParallelRepricer() {
+        {
+            lock_guard<mutex> guard(this->lock);
+            this->stopping = true;
+        }
+        this->wake.notify_all();
+        for (auto &t : this->threads) {
+            t.join();
+        }
+    }
+};
+
+// 解析命令行中的线程数，须是[1, maxThreads]内的整数，否则返回0
+size_t parseThreadCount(const char *text, size_t maxThreads) {
+    char *end = nullptr;
+    long long value = strtoll(text, &end, 10);
+    if (end == text || *end != '\0' || value < 1 || static_cast<unsigned long long>(value) > maxThreads) {
+        return 0;
+    }
+    return static_cast<size_t>(value);
+}
+
+//用法：策略模式 [线程数]，指定线程数时使用并行定价，输出与串行相同
+int main(int argc, char *argv[]) {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
+    const size_t maxThreads = 1024;
+    size_t threads = argc > 1 ? parseThreadCount(argv[1], maxThreads) : 1;
+    if (argc > 2 || threads == 0) {
+        cerr << "usage: " << argv[0] << " [threads, 1-" << maxThreads << "]" << '\n';
+        return 2;
+    }
+    DiscountRegistry registry;
     int N;
     cin >> N;
-    vector<int> ans(N);
-    int i=0;
-    while (N--) {
-        int originalPrice, strategy;
-        cin >> originalPrice >> strategy;
-        DiscountStrategy* discountStrategy;
-        switch (strategy) {
-            case 1:
-                discountStrategy = new NineDiscount();
-                break;
-            case 2:
-                discountStrategy= new subDiscount();
-                break;
-            default:
-                cout<<"Unknown strategy type"<<endl;
-                return 1;
-        }
-        DiscountContext context{};
-        context.setDiscountStrategy(discountStrategy);
-
-        int discountPrice = context.applyDiscount(originalPrice);
-        ans[i++]=discountPrice;
-
-        delete discountStrategy;
+    vector<int> prices(N), strategies(N), ans;
+    for (int i = 0; i < N; ++i) {
+        cin >> prices[i] >> strategies[i];
+        if (!registry.contains(strategies[i])) {
+            cout<<"Unknown strategy type"<<'\n';
+            return 1;
+        }
+    }
+    //按策略分组后每组只分派一次，且不再为每件商品创建策略对象
+    if (argc > 1) {
+        ParallelRepricer repricer(threads);
+        repricer.reprice(prices, strategies, ans);
+    } else {
+        registry.applyGrouped(prices, strategies, ans);
     }
     for (int an : ans) {
-        cout<<an<<endl;
+        cout<<an<<'\n';
     }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,319 @@
+/* 策略模式的基准测试。
+ * scaling：ParallelRepricer的强扩展性，固定的输入规模下，线程数从1翻倍到最大线程数（默认64），
+ *   与预热后的串行DiscountRegistry::applyGrouped比较耗时，并逐项核对输出与串行结果相同。
+ * batch：每个具体策略逐个价格调用虚函数applyDiscount与一次applyDiscountBatch（SSE2）的每价格耗时，
+ *   价格覆盖正负、大小与int边界值，并核对两者的结果逐位相同。
+ * registry：原来每件商品new一个具体策略再经DiscountContext调用的做法，与DiscountRegistry逐件visit、
+ *   预热后的applyGrouped分组批量计算，比较每件耗时与每件的堆分配次数，并核对结果相同。
+ * tiers：4、64、1024档的分档满减表上每个价格的查找耗时：逐档线性扫描、有序门槛上的std::upper_bound、
+ *   TieredDiscount的稠密查找表与Eytzinger二分（不建查找表），并核对四者结果相同；
+ *   另测两个TieredDiscount实例交替逐件调用applyDiscount时的耗时，检查线程缓存不会在实例间来回失效。
+ * 编译：g++ -std=c++17 -O2 -pthread 策略模式_benchmark.cpp
+ * 用法：策略模式_benchmark scaling [商品数，默认1e8] [块大小，默认65536] [重复次数，默认3，取最快一次] [最大线程数，默认64]
+ *       策略模式_benchmark batch [价格数，默认1e8]
+ *       策略模式_benchmark registry [商品数，默认1e7]
+ *       策略模式_benchmark tiers [价格数，默认2e7]
+ */
+//复用模式程序中的类，程序自己的main改名后不使用
+#define main strategyProgramMain
+#include "策略模式.cpp"
+#undef main
+
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <string>
+
+using BenchClock = chrono::steady_clock;
+
+// 统计全局operator new的调用次数；scaling模式下多个线程都会分配，因此用原子计数。
+// new与delete都不内联：内联到标准容器里后，GCC会把malloc/free与new/delete误判为不配对并告警
+static atomic<unsigned long long> allocations{0};
+
+__attribute__((noinline)) void *operator new(size_t size) {
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void *p = malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+template<typename Body>
+double bestSeconds(int repeats, Body body) {
+    double best = 0;
+    for (int r = 0; r < repeats; ++r) {
+        auto start = BenchClock::now();
+        body();
+        double seconds = chrono::duration<double>(BenchClock::now() - start).count();
+        if (r == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+int benchmarkScaling(int argc, char *argv[]) {
+    long long itemArgument = argc > 2 ? atoll(argv[2]) : 100000000;
+    long long chunkArgument = argc > 3 ? atoll(argv[3]) : 1 << 16;
+    int repeats = argc > 4 ? atoi(argv[4]) : 3;
+    size_t maxThreads = argc > 5 ? parseThreadCount(argv[5], 1024) : 64;
+    if (itemArgument < 1 || chunkArgument < 1 || repeats < 1 || maxThreads == 0) {
+        fprintf(stderr, "scaling: items, chunk and repeats must be positive, max threads 1-1024\n");
+        return 2;
+    }
+    size_t items = static_cast<size_t>(itemArgument);
+    size_t chunkSize = static_cast<size_t>(chunkArgument);
+
+    mt19937 rng(42);
+    uniform_int_distribution<int> price(1, 1000);
+    vector<int> prices(items), ids(items);
+    for (size_t i = 0; i < items; ++i) {
+        prices[i] = price(rng);
+        ids[i] = static_cast<int>(rng() & 1) + 1;
+    }
+
+    DiscountRegistry registry;
+    vector<int> expected;
+    double serial = bestSeconds(repeats, [&] { registry.applyGrouped(prices, ids, expected); });
+    cout << items << " items, chunk " << chunkSize << ", " << thread::hardware_concurrency() << " hardware threads" << '\n';
+    cout << "serial applyGrouped: " << serial << " s" << '\n';
+
+    vector<int> out;
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        ParallelRepricer repricer(threads);
+        double seconds = bestSeconds(repeats, [&] { repricer.reprice(prices, ids, out, chunkSize); });
+        cout << threads << " threads: " << seconds << " s, speedup " << serial / seconds
+             << (out == expected ? "" : ", OUTPUT MISMATCH") << '\n';
+        if (out != expected) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// 不内联，保证逐个价格都经过一次虚函数调用，与原来的用法相同
+__attribute__((noinline)) void applyOneByOne(DiscountStrategy &strategy, const vector<int> &in, vector<int> &out) {
+    for (size_t i = 0; i < in.size(); ++i) {
+        out[i] = strategy.applyDiscount(in[i]);
+    }
+}
+
+int benchmarkBatch(size_t count) {
+    // 四分之一任意int、四分之一[0,1000)、四分之一[-1e6,1e6]、四分之一贴近满减门槛的[0,400)
+    mt19937 rng(3);
+    vector<int> prices(count);
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t r = rng();
+        switch (i % 4) {
+            case 0: prices[i] = static_cast<int>(r); break;
+            case 1: prices[i] = static_cast<int>(r % 1000); break;
+            case 2: prices[i] = static_cast<int>(r % 2000001) - 1000000; break;
+            default: prices[i] = static_cast<int>(r % 400); break;
+        }
+    }
+    const int edges[] = {INT_MAX, INT_MIN + 1, 5, -5, 15, -15, 99, 100, 299, 300};
+    for (size_t i = 0; i < size(edges) && i < count; ++i) {
+        prices[i] = edges[i];
+    }
+
+    NineDiscount nineDiscount;
+    subDiscount sub;
+    pair<const char *, DiscountStrategy *> strategies[] = {{"NineDiscount", &nineDiscount}, {"subDiscount", &sub}};
+    vector<int> scalar(count), batch(count);
+    printf("%zu prices, ns/price\n", count);
+    bool identical = true;
+    for (auto &[name, strategy]: strategies) {
+        auto start = BenchClock::now();
+        applyOneByOne(*strategy, prices, scalar);
+        double scalarNanos = chrono::duration<double, nano>(BenchClock::now() - start).count() / count;
+        start = BenchClock::now();
+        strategy->applyDiscountBatch(prices.data(), batch.data(), count);
+        double batchNanos = chrono::duration<double, nano>(BenchClock::now() - start).count() / count;
+        bool same = scalar == batch;
+        identical = identical && same;
+        printf("%-12s virtual per price %5.2f  batch %5.2f  speedup %4.1fx  %s\n", name, scalarNanos, batchNanos,
+               scalarNanos / batchNanos, same ? "bit-identical" : "RESULTS DIFFER");
+    }
+    return identical ? 0 : 1;
+}
+
+int benchmarkRegistry(size_t items) {
+    mt19937 rng(4);
+    vector<int> prices(items), ids(items);
+    for (size_t i = 0; i < items; ++i) {
+        prices[i] = static_cast<int>(rng() % 500) + 1;
+        ids[i] = static_cast<int>(rng() % 2) + 1;
+    }
+    vector<int> legacy(items), visited(items), grouped;
+
+    // 原来的做法：每件商品new一个具体策略，经上下文调用后delete
+    unsigned long long before = allocations.load();
+    auto start = BenchClock::now();
+    for (size_t i = 0; i < items; ++i) {
+        DiscountStrategy *discountStrategy;
+        if (ids[i] == 1) {
+            discountStrategy = new NineDiscount();
+        } else {
+            discountStrategy = new subDiscount();
+        }
+        DiscountContext context{};
+        context.setDiscountStrategy(discountStrategy);
+        legacy[i] = context.applyDiscount(prices[i]);
+        delete discountStrategy;
+    }
+    double legacyNanos = chrono::duration<double, nano>(BenchClock::now() - start).count() / items;
+    double legacyAllocations = static_cast<double>(allocations.load() - before) / items;
+
+    DiscountRegistry registry;
+    before = allocations.load();
+    start = BenchClock::now();
+    for (size_t i = 0; i < items; ++i) {
+        visited[i] = registry.applyDiscount(ids[i], prices[i]);
+    }
+    double visitNanos = chrono::duration<double, nano>(BenchClock::now() - start).count() / items;
+    double visitAllocations = static_cast<double>(allocations.load() - before) / items;
+
+    // 第一次调用分配分组缓冲区，之后的调用复用它们
+    registry.applyGrouped(prices, ids, grouped);
+    before = allocations.load();
+    start = BenchClock::now();
+    registry.applyGrouped(prices, ids, grouped);
+    double groupedNanos = chrono::duration<double, nano>(BenchClock::now() - start).count() / items;
+    unsigned long long groupedAllocations = allocations.load() - before;
+
+    bool identical = visited == legacy && grouped == legacy;
+    printf("%zu items\n", items);
+    printf("new per item + DiscountContext: %5.2f ns/item, %.2f allocations/item\n", legacyNanos, legacyAllocations);
+    printf("registry visit per item:        %5.2f ns/item, %.2f allocations/item\n", visitNanos, visitAllocations);
+    printf("registry applyGrouped (warm):   %5.2f ns/item, %llu allocations in total\n", groupedNanos,
+           groupedAllocations);
+    printf("%s\n", identical ? "results identical" : "RESULTS DIFFER");
+    return identical ? 0 : 1;
+}
+
+template<typename Body>
+double nanosPerPrice(size_t count, Body body) {
+    auto start = BenchClock::now();
+    body();
+    return chrono::duration<double, nano>(BenchClock::now() - start).count() / count;
+}
+
+int benchmarkTiers(size_t count) {
+    // 与subDiscount同样的四档，查找表与Eytzinger两条路径都应与它逐个价格相同
+    subDiscount sub;
+    TieredDiscount withLut({{100, 5}, {150, 15}, {200, 25}, {300, 40}});
+    TieredDiscount withoutLut({{300, 40}, {100, 5}, {200, 25}, {150, 15}}, 0);
+    for (int price = -1000; price < 200000; ++price) {
+        int expected = sub.applyDiscount(price);
+        if (withLut.applyDiscount(price) != expected || withoutLut.applyDiscount(price) != expected) {
+            printf("TieredDiscount differs from subDiscount at price %d\n", price);
+            return 1;
+        }
+    }
+
+    mt19937 rng(5);
+    vector<int> prices(count);
+    for (int &price: prices) {
+        price = static_cast<int>(rng() % 120000);
+    }
+    vector<int> linear(count), binary(count), lut(count), eytzinger(count);
+    printf("%zu prices in [0, 120000), ns/price\n", count);
+    bool identical = true;
+    for (size_t bracketCount: {size_t{4}, size_t{64}, size_t{1024}}) {
+        set<int> used;
+        vector<pair<int, int>> brackets;
+        while (brackets.size() < bracketCount) {
+            int threshold = static_cast<int>(rng() % 100000) + 1;
+            if (used.insert(threshold).second) {
+                brackets.emplace_back(threshold, 0);
+            }
+        }
+        sort(brackets.begin(), brackets.end());
+        vector<int> thresholds, discounts;
+        for (size_t k = 0; k < brackets.size(); ++k) {
+            brackets[k].second = static_cast<int>(k + 1) * 3;
+            thresholds.push_back(brackets[k].first);
+            discounts.push_back(brackets[k].second);
+        }
+
+        // 与subDiscount::applyDiscount相同的做法：从最高档往下找第一个不超过价格的门槛
+        double linearNanos = nanosPerPrice(count, [&] {
+            for (size_t i = 0; i < count; ++i) {
+                int reduction = 0;
+                for (size_t k = bracketCount; k-- > 0;) {
+                    if (prices[i] >= thresholds[k]) {
+                        reduction = discounts[k];
+                        break;
+                    }
+                }
+                linear[i] = prices[i] - reduction;
+            }
+        });
+        double binaryNanos = nanosPerPrice(count, [&] {
+            for (size_t i = 0; i < count; ++i) {
+                auto above = upper_bound(thresholds.begin(), thresholds.end(), prices[i]);
+                binary[i] = prices[i] - (above == thresholds.begin() ? 0 : discounts[above - thresholds.begin() - 1]);
+            }
+        });
+        TieredDiscount lutTable(brackets, 1 << 17);
+        TieredDiscount eytzingerTable(brackets, 0);
+        double lutNanos = nanosPerPrice(count, [&] { lutTable.applyDiscountBatch(prices.data(), lut.data(), count); });
+        double eytzingerNanos = nanosPerPrice(count, [&] {
+            eytzingerTable.applyDiscountBatch(prices.data(), eytzinger.data(), count);
+        });
+        bool same = linear == binary && binary == lut && lut == eytzinger;
+        identical = identical && same;
+        printf("%4zu brackets: linear %6.2f  upper_bound %6.2f  LUT %5.2f  Eytzinger %5.2f  %s\n", bracketCount,
+               linearNanos, binaryNanos, lutNanos, eytzingerNanos, same ? "identical" : "RESULTS DIFFER");
+    }
+
+    // 两个实例交替逐件定价：线程缓存按实例分槽，每件只需一次原子的版本号读取
+    TieredDiscount first({{100, 5}, {150, 15}}, 0);
+    TieredDiscount second({{200, 25}, {300, 40}}, 0);
+    long long checksum = 0;
+    double alternatingNanos = nanosPerPrice(count, [&] {
+        for (size_t i = 0; i < count; ++i) {
+            checksum += (i & 1 ? second : first).applyDiscount(prices[i]);
+        }
+    });
+    double singleNanos = nanosPerPrice(count, [&] {
+        for (size_t i = 0; i < count; ++i) {
+            checksum -= first.applyDiscount(prices[i]);
+        }
+    });
+    printf("applyDiscount per item: one instance %.2f, two alternating instances %.2f (checksum %lld)\n", singleNanos,
+           alternatingNanos, checksum);
+    return identical ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    string mode = argc > 1 ? argv[1] : "";
+    if (mode == "scaling") {
+        return benchmarkScaling(argc, argv);
+    }
+    if (mode == "batch") {
+        long long count = argc > 2 ? atoll(argv[2]) : 0;
+        return benchmarkBatch(count > 0 ? static_cast<size_t>(count) : 100000000);
+    }
+    if (mode == "registry") {
+        long long items = argc > 2 ? atoll(argv[2]) : 0;
+        return benchmarkRegistry(items > 0 ? static_cast<size_t>(items) : 10000000);
+    }
+    if (mode == "tiers") {
+        long long prices = argc > 2 ? atoll(argv[2]) : 0;
+        return benchmarkTiers(prices > 0 ? static_cast<size_t>(prices) : 20000000);
+    }
+    fprintf(stderr, "usage: 策略模式_benchmark scaling [items] [chunk] [repeats] [max threads] | batch [prices] | registry [items]"
+                    " | tiers [prices]\n");
+    return 2;
+}
@@ -1,6 +1,22 @@
 #include<iostream>
 #include<vector>
 #include <list>
+#include <cstdint>
+#include <memory>
+#include <typeindex>
+#include <typeinfo>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <stdexcept>
+#include <chrono>
+#include <functional>
+#include <initializer_list>
 
 using namespace std;
 
@@ -22,6 +38,13 @@ class Observer {
 public:
     virtual void update(int hour) = 0;
 
+    //批量投递：一次收到从firstHour开始的count个连续tick，默认逐个转给update
+    virtual void updateRange(int firstHour, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            update(static_cast<int>((firstHour + i) % 24));
+        }
+    }
+
     virtual ~Observer() = default;
 };
 
@@ -36,31 +59,1073 @@ public:
     virtual ~Subject() = default;
 };
 
+//订阅句柄：槽位下标+代数，槽位被复用后旧句柄的代数对不上，用它退订会被忽略
+struct Subscription {
+    uint32_t slot;
+    uint32_t generation;
+};
+
+//同一具体类型的观察者连续存放在一个分组里，通知时每组只做一次虚调用，组内逐个非虚调用
+class ObserverGroup {
+public:
+    //与观察者数组一一对应，记录每个位置属于哪个句柄槽位，swap-remove时用来回填槽位的新位置
+    vector<uint32_t> slots;
+
+    //只通知[begin, end)位置上的观察者，异步模式下每个工作线程负责其中一段
+    virtual void notifyRange(int hour, size_t begin, size_t end) = 0;
+
+    void notifyAll(int hour) {
+        notifyRange(hour, 0, size());
+    }
+
+    virtual Observer *at(size_t position) const = 0;
+
+    //用末尾元素覆盖position处再弹出末尾，O(1)
+    virtual void swapRemove(size_t position) = 0;
+
+    size_t size() const {
+        return this->slots.size();
+    }
+
+    virtual ~ObserverGroup() = default;
+};
+
+template<typename T>
+class TypedObserverGroup : public ObserverGroup {
+private:
+    vector<T *> observers;
+public:
+    void push(T *observer, uint32_t slot) {
+        this->observers.push_back(observer);
+        this->slots.push_back(slot);
+    }
+
+    void notifyRange(int hour, size_t begin, size_t end) override {
+        for (size_t i = begin; i < end; ++i) {
+            T *observer = this->observers[i];
+            if constexpr (is_same<T, Observer>::value) {
+                //具体类型未知的观察者只能逐个虚调用
+                observer->update(hour);
+            } else {
+                //限定名调用不走虚表，可以被内联
+                observer->T::update(hour);
+            }
+        }
+    }
+
+    Observer *at(size_t position) const override {
+        return this->observers[position];
+    }
+
+    void swapRemove(size_t position) override {
+        this->observers[position] = this->observers.back();
+        this->observers.pop_back();
+        this->slots[position] = this->slots.back();
+        this->slots.pop_back();
+    }
+};
+
+//观察者注册表：按具体类型分组连续存放，句柄稳定，退订O(1)
+//退订会把组内末尾元素换到空位上，所以退订之后组内的通知顺序不再是订阅顺序
+class ObserverRegistry {
+private:
+    static constexpr uint32_t freePosition = UINT32_MAX;
+
+    struct Slot {
+        uint32_t group;
+        uint32_t position;
+        uint32_t generation;
+    };
+
+    vector<unique_ptr<ObserverGroup>> groups;
+    unordered_map<type_index, uint32_t> groupOfType;
+    vector<Slot> slotTable;
+    vector<uint32_t> freeSlots;
+    size_t count = 0;
+
+    template<typename T>
+    TypedObserverGroup<T> &groupFor(uint32_t &groupIndex) {
+        auto it = this->groupOfType.find(type_index(typeid(T)));
+        if (it == this->groupOfType.end()) {
+            groupIndex = static_cast<uint32_t>(this->groups.size());
+            this->groups.emplace_back(new TypedObserverGroup<T>());
+            this->groupOfType.emplace(type_index(typeid(T)), groupIndex);
+        } else {
+            groupIndex = it->second;
+        }
+        return static_cast<TypedObserverGroup<T> &>(*this->groups[groupIndex]);
+    }
+
+    template<typename T>
+    Subscription subscribeTo(T *observer) {
+        uint32_t groupIndex;
+        TypedObserverGroup<T> &group = groupFor<T>(groupIndex);
+        uint32_t slot;
+        if (this->freeSlots.empty()) {
+            slot = static_cast<uint32_t>(this->slotTable.size());
+            this->slotTable.push_back(Slot{0, 0, 0});
+        } else {
+            slot = this->freeSlots.back();
+            this->freeSlots.pop_back();
+        }
+        Slot &entry = this->slotTable[slot];
+        entry.group = groupIndex;
+        entry.position = static_cast<uint32_t>(group.size());
+        group.push(observer, slot);
+        ++this->count;
+        return Subscription{slot, entry.generation};
+    }
+
+public:
+    //静态类型就是实际类型时归入该类型的分组；否则（传入基类指针或T的子类）归入通用分组逐个虚调用
+    template<typename T>
+    Subscription subscribe(T *observer) {
+        static_assert(is_base_of<Observer, T>::value, "T must derive from Observer");
+        if constexpr (is_same<T, Observer>::value) {
+            return subscribeTo<Observer>(observer);
+        } else {
+            if (typeid(*observer) != typeid(T)) {
+                return subscribeTo<Observer>(observer);
+            }
+            return subscribeTo<T>(observer);
+        }
+    }
+
+    //句柄已失效（重复退订或槽位已复用）时返回false
+    bool unsubscribe(Subscription subscription) {
+        if (subscription.slot >= this->slotTable.size()) {
+            return false;
+        }
+        Slot &entry = this->slotTable[subscription.slot];
+        if (entry.position == freePosition || entry.generation != subscription.generation) {
+            return false;
+        }
+        ObserverGroup &group = *this->groups[entry.group];
+        group.swapRemove(entry.position);
+        if (entry.position < group.size()) {
+            this->slotTable[group.slots[entry.position]].position = entry.position;
+        }
+        entry.position = freePosition;
+        ++entry.generation;
+        this->freeSlots.push_back(subscription.slot);
+        --this->count;
+        return true;
+    }
+
+    //按指针删除需要查找，O(n)；热路径应保存句柄用unsubscribe
+    void remove(Observer *observer) {
+        for (auto &group: this->groups) {
+            for (size_t i = 0; i < group->size();) {
+                if (group->at(i) == observer) {
+                    uint32_t slot = group->slots[i];
+                    unsubscribe(Subscription{slot, this->slotTable[slot].generation});
+                } else {
+                    ++i;
+                }
+            }
+        }
+    }
+
+    void notifyAll(int hour) {
+        for (auto &group: this->groups) {
+            group->notifyAll(hour);
+        }
+    }
+
+    //把每个分组均分成parts段，通知第part段；各段互不重叠，合起来正好覆盖全部观察者
+    void notifyPart(int hour, size_t part, size_t parts) {
+        for (auto &group: this->groups) {
+            size_t n = group->size();
+            group->notifyRange(hour, n * part / parts, n * (part + 1) / parts);
+        }
+    }
+
+    template<typename Function>
+    void forEach(Function function) const {
+        for (auto &group: this->groups) {
+            for (size_t i = 0; i < group->size(); ++i) {
+                function(group->at(i));
+            }
+        }
+    }
+
+    size_t size() const {
+        return this->count;
+    }
+};
+
+//关注的小时集合，编译成24位掩码，第h位为1表示关注h点
+class HourFilter {
+private:
+    uint32_t mask;
+
+    explicit HourFilter(uint32_t mask) : mask(mask) {}
+
+public:
+    static constexpr uint32_t allHours = (1u << 24) - 1;
+
+    static HourFilter all() {
+        return HourFilter(allHours);
+    }
+
+    static HourFilter hours(initializer_list<int> hours) {
+        uint32_t mask = 0;
+        for (int hour: hours) {
+            if (hour < 0 || hour >= 24) {
+                throw invalid_argument("hour out of range: " + to_string(hour));
+            }
+            mask |= 1u << hour;
+        }
+        return HourFilter(mask);
+    }
+
+    //hour % modulus == remainder的小时
+    static HourFilter every(int modulus, int remainder = 0) {
+        if (modulus <= 0 || remainder < 0 || remainder >= modulus) {
+            throw invalid_argument("invalid modulus filter");
+        }
+        uint32_t mask = 0;
+        for (int hour = remainder; hour < 24; hour += modulus) {
+            mask |= 1u << hour;
+        }
+        return HourFilter(mask);
+    }
+
+    static HourFilter fromMask(uint32_t mask) {
+        return HourFilter(mask & allHours);
+    }
+
+    HourFilter operator|(HourFilter other) const {
+        return HourFilter(this->mask | other.mask);
+    }
+
+    HourFilter operator&(HourFilter other) const {
+        return HourFilter(this->mask & other.mask);
+    }
+
+    bool matches(int hour) const {
+        return (this->mask >> hour) & 1u;
+    }
+
+    uint32_t bits() const {
+        return this->mask;
+    }
+};
+
+struct FilteredSubscription {
+    uint32_t slot;
+    uint32_t generation;
+};
+
+//按小时建立倒排索引：每个小时一个注册表，订阅按掩码登记到关注的那几个小时里，
+//通知时只遍历当前小时的注册表，开销与关注者数量成正比，与订阅总数无关
+class HourIndex {
+private:
+    struct Entry {
+        Observer *observer = nullptr;
+        uint32_t mask = 0;
+        uint32_t generation = 0;
+        //按掩码中置位的小时从小到大排列
+        vector<Subscription> handles;
+    };
+
+    ObserverRegistry byHour[24];
+    vector<Entry> entries;
+    vector<uint32_t> freeEntries;
+    size_t count = 0;
+
+public:
+    template<typename T>
+    FilteredSubscription subscribe(T *observer, HourFilter filter) {
+        uint32_t slot;
+        if (this->freeEntries.empty()) {
+            slot = static_cast<uint32_t>(this->entries.size());
+            this->entries.emplace_back();
+        } else {
+            slot = this->freeEntries.back();
+            this->freeEntries.pop_back();
+        }
+        Entry &entry = this->entries[slot];
+        entry.observer = observer;
+        entry.mask = filter.bits();
+        entry.handles.reserve(__builtin_popcount(entry.mask));
+        for (uint32_t rest = entry.mask; rest != 0; rest &= rest - 1) {
+            entry.handles.push_back(this->byHour[__builtin_ctz(rest)].subscribe(observer));
+        }
+        ++this->count;
+        return FilteredSubscription{slot, entry.generation};
+    }
+
+    //O(关注的小时数)
+    bool unsubscribe(FilteredSubscription subscription) {
+        if (subscription.slot >= this->entries.size()) {
+            return false;
+        }
+        Entry &entry = this->entries[subscription.slot];
+        if (entry.observer == nullptr || entry.generation != subscription.generation) {
+            return false;
+        }
+        size_t i = 0;
+        for (uint32_t rest = entry.mask; rest != 0; rest &= rest - 1) {
+            this->byHour[__builtin_ctz(rest)].unsubscribe(entry.handles[i++]);
+        }
+        entry.observer = nullptr;
+        entry.handles.clear();
+        entry.handles.shrink_to_fit();
+        ++entry.generation;
+        this->freeEntries.push_back(subscription.slot);
+        --this->count;
+        return true;
+    }
+
+    void notify(int hour) {
+        this->byHour[hour].notifyAll(hour);
+    }
+
+    void notifyPart(int hour, size_t part, size_t parts) {
+        this->byHour[hour].notifyPart(hour, part, parts);
+    }
+
+    //每个订阅只访问一次，不论它关注几个小时
+    template<typename Function>
+    void forEach(Function function) const {
+        for (const Entry &entry: this->entries) {
+            if (entry.observer != nullptr) {
+                function(entry.observer);
+            }
+        }
+    }
+
+    size_t interested(int hour) const {
+        return this->byHour[hour].size();
+    }
+
+    size_t size() const {
+        return this->count;
+    }
+};
+
+//异步并行通知：工作线程i固定负责注册表的第i段（由notifyPart回调决定具体怎么切），按先后顺序处理投递给它的每个tick
+//注册表不变时同一观察者总由同一线程通知，所以每个观察者收到的tick仍然有序；
+//修改注册表前必须先waitIdle排空在途的tick，由Clock负责保证
+class AsyncNotifier {
+private:
+    struct Worker {
+        thread handle;
+        mutex lock;
+        condition_variable notEmpty;
+        condition_variable notFull;
+        deque<int> hours;
+        bool stopping = false;
+    };
+
+    function<void(int, size_t, size_t)> notifyPart;
+    vector<unique_ptr<Worker>> workers;
+    size_t maxBacklog;
+
+    //尚未完成的(tick, 工作线程)投递数，降到0时唤醒waitIdle
+    size_t pending = 0;
+    mutex pendingLock;
+    condition_variable idle;
+
+    void run(size_t part) {
+        Worker &worker = *this->workers[part];
+        deque<int> batch;
+        for (;;) {
+            {
+                unique_lock<mutex> guard(worker.lock);
+                worker.notEmpty.wait(guard, [&] { return worker.stopping || !worker.hours.empty(); });
+                if (worker.hours.empty()) {
+                    return;
+                }
+                batch.swap(worker.hours);
+            }
+            worker.notFull.notify_one();
+            for (int hour: batch) {
+                this->notifyPart(hour, part, this->workers.size());
+            }
+            size_t done = batch.size();
+            batch.clear();
+            lock_guard<mutex> guard(this->pendingLock);
+            this->pending -= done;
+            if (this->pending == 0) {
+                this->idle.notify_all();
+            }
+        }
+    }
+
+public:
+    //maxBacklog：单个工作线程最多积压的tick数，超过后post阻塞，防止慢观察者让队列无限增长
+    //notifyPart(hour, part, parts)：通知parts段中的第part段
+    AsyncNotifier(function<void(int, size_t, size_t)> notifyPart, size_t threads, size_t maxBacklog = 1024)
+            : notifyPart(move(notifyPart)), maxBacklog(maxBacklog) {
+        if (threads == 0) {
+            threads = 1;
+        }
+        for (size_t i = 0; i < threads; ++i) {
+            this->workers.emplace_back(new Worker());
+        }
+        for (size_t i = 0; i < threads; ++i) {
+            this->workers[i]->handle = thread(&AsyncNotifier::run, this, i);
+        }
+    }
+
+    AsyncNotifier(const AsyncNotifier &) = delete;
+
+    AsyncNotifier &operator=(const AsyncNotifier &) = delete;
+
+    void post(int hour) {
+        {
+            lock_guard<mutex> guard(this->pendingLock);
+            this->pending += this->workers.size();
+        }
+        for (auto &worker: this->workers) {
+            unique_lock<mutex> guard(worker->lock);
+            worker->notFull.wait(guard, [&] { return worker->hours.size() < this->maxBacklog; });
+            worker->hours.push_back(hour);
+            guard.unlock();
+            worker->notEmpty.notify_one();
+        }
+    }
+
+    //完成屏障：返回时此前post的所有tick都已通知到每个观察者
+    void waitIdle() {
+        unique_lock<mutex> guard(this->pendingLock);
+        this->idle.wait(guard, [this] { return this->pending == 0; });
+    }
+
+    ~AsyncNotifier() {
+        for (auto &worker: this->workers) {
+            lock_guard<mutex> guard(worker->lock);
+            worker->stopping = true;
+        }
+        for (auto &worker: this->workers) {
+            worker->notEmpty.notify_one();
+            worker->handle.join();
+        }
+    }
+};
+
+//投递策略：每个事件都投递 / 只投递最新的一个（合并） / 把积压的连续tick分批一次投递
+enum class DeliveryPolicy {
+    EveryEvent,
+    LatestOnly,
+    Batched
+};
+
+//与Subscription相同：句柄槽位退订后复用，旧句柄的代数对不上，用它退订或查询会被忽略
+struct PolicySubscription {
+    uint32_t index;
+    uint32_t generation;
+};
+
+//按游标投递：tick只把序号加一，O(1)，不等待任何观察者；
+//每个订阅记录自己已投递到的序号，投递线程认领落后的订阅按其策略补齐，
+//慢观察者只拖慢自己，快观察者不受影响。第seq个tick的hour是(baseHour + seq) % 24，无需保存事件本身
+class CursorDispatcher {
+private:
+    struct Cursor {
+        Observer *observer;
+        DeliveryPolicy policy;
+        size_t maxBatch;
+        atomic<uint64_t> delivered;
+        atomic<bool> busy{false};
+        atomic<bool> active{true};
+        atomic<uint64_t> calls{0};
+        atomic<uint64_t> maxLag{0};
+        size_t position = 0;
+
+        Cursor(Observer *observer, DeliveryPolicy policy, size_t maxBatch, uint64_t start)
+                : observer(observer), policy(policy), maxBatch(maxBatch), delivered(start) {}
+    };
+
+    int baseHour;
+    atomic<uint64_t> sequence{0};
+    bool stopping = false;
+    mutex wakeLock;
+    condition_variable wake;
+    //退订时等待正在投递的线程放手
+    mutex idleLock;
+    condition_variable idle;
+
+    struct HandleSlot {
+        shared_ptr<Cursor> cursor;
+        uint32_t generation = 0;
+    };
+
+    //订阅表只在加锁时修改；工作线程在版本号变化时复制一份，shared_ptr保证退订后游标仍可安全访问
+    //cursors是紧凑的扫描表，退订时swap-remove；byHandle按句柄下标查找，退订后槽位进入freeHandles等待复用
+    mutex listLock;
+    vector<shared_ptr<Cursor>> cursors;
+    vector<HandleSlot> byHandle;
+    vector<uint32_t> freeHandles;
+    atomic<uint64_t> listVersion{0};
+    vector<thread> workers;
+
+    int hourOf(uint64_t seq) const {
+        return static_cast<int>((this->baseHour + seq) % 24);
+    }
+
+    //一次认领最多占用投递线程的时间，用完就放回去让线程先服务别的订阅，
+    //否则跟不上的EveryEvent慢观察者会把所有投递线程占住，快观察者也跟着饿死
+    static constexpr chrono::microseconds deliveryQuantum{100};
+
+    //把cursor往target补，调用者已认领cursor
+    void deliver(Cursor &cursor, uint64_t target) {
+        uint64_t from = cursor.delivered.load(memory_order_relaxed);
+        uint64_t lag = target - from;
+        if (lag > cursor.maxLag.load(memory_order_relaxed)) {
+            cursor.maxLag.store(lag, memory_order_relaxed);
+        }
+        if (cursor.policy == DeliveryPolicy::LatestOnly) {
+            cursor.observer->update(hourOf(target));
+            cursor.delivered.store(target, memory_order_release);
+            cursor.calls.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        //EveryEvent每次投递一个tick，Batched每次投递至多maxBatch个
+        uint64_t step = cursor.policy == DeliveryPolicy::EveryEvent ? 1 : cursor.maxBatch;
+        auto deadline = chrono::steady_clock::now() + deliveryQuantum;
+        while (from < target) {
+            uint64_t count = min<uint64_t>(target - from, step);
+            if (count == 1) {
+                cursor.observer->update(hourOf(from + 1));
+            } else {
+                cursor.observer->updateRange(hourOf(from + 1), count);
+            }
+            from += count;
+            cursor.delivered.store(from, memory_order_release);
+            cursor.calls.fetch_add(1, memory_order_relaxed);
+            if (from < target && chrono::steady_clock::now() >= deadline) {
+                break;
+            }
+        }
+    }
+
+    void run(size_t index) {
+        vector<shared_ptr<Cursor>> local;
+        uint64_t localVersion = UINT64_MAX;
+        for (;;) {
+            if (this->listVersion.load(memory_order_acquire) != localVersion) {
+                lock_guard<mutex> guard(this->listLock);
+                local = this->cursors;
+                localVersion = this->listVersion.load(memory_order_relaxed);
+            }
+            uint64_t target = this->sequence.load(memory_order_acquire);
+            bool progressed = false;
+            //各线程从不同位置开始扫描，减少认领冲突
+            size_t n = local.size();
+            for (size_t k = 0; k < n; ++k) {
+                Cursor &cursor = *local[(index * n / this->workers.size() + k) % n];
+                //busy/active与unsubscribe构成先写后读的握手：这边先置busy再读active，那边先清active再读busy，
+                //必须都是seq_cst，否则两边可能都读到对方写之前的值，退订返回后observer仍被调用
+                if (cursor.delivered.load(memory_order_acquire) >= target ||
+                    cursor.busy.exchange(true, memory_order_seq_cst)) {
+                    continue;
+                }
+                if (cursor.active.load(memory_order_seq_cst)) {
+                    //认领期间又来了新tick就一并补上
+                    deliver(cursor, max(target, this->sequence.load(memory_order_acquire)));
+                    progressed = true;
+                }
+                //放手时是同一个握手的另一半：先清busy再读active，读到已退订就唤醒可能在等的unsubscribe
+                cursor.busy.store(false, memory_order_seq_cst);
+                if (!cursor.active.load(memory_order_seq_cst)) {
+                    lock_guard<mutex> guard(this->idleLock);
+                    this->idle.notify_all();
+                }
+            }
+            if (!progressed) {
+                unique_lock<mutex> guard(this->wakeLock);
+                this->wake.wait(guard, [&] {
+                    return this->stopping || this->sequence.load(memory_order_relaxed) != target ||
+                           this->listVersion.load(memory_order_relaxed) != localVersion;
+                });
+                if (this->stopping) {
+                    return;
+                }
+            }
+        }
+    }
+
+    void bumpVersion() {
+        {
+            lock_guard<mutex> guard(this->wakeLock);
+            this->listVersion.fetch_add(1, memory_order_release);
+        }
+        this->wake.notify_all();
+    }
+
+public:
+    CursorDispatcher(int baseHour, size_t threads) : baseHour(baseHour) {
+        if (threads == 0) {
+            threads = 1;
+        }
+        //先把workers填满再启动，run里要用workers.size()
+        this->workers.resize(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            this->workers[i] = thread(&CursorDispatcher::run, this, i);
+        }
+    }
+
+    CursorDispatcher(const CursorDispatcher &) = delete;
+
+    CursorDispatcher &operator=(const CursorDispatcher &) = delete;
+
+    //新订阅只接收之后的tick；maxBatch只对Batched有效，限制一次updateRange的tick数
+    PolicySubscription subscribe(Observer *observer, DeliveryPolicy policy, size_t maxBatch) {
+        uint32_t index;
+        uint32_t generation;
+        {
+            lock_guard<mutex> guard(this->listLock);
+            auto cursor = make_shared<Cursor>(observer, policy, maxBatch == 0 ? 1 : maxBatch, this->sequence.load());
+            cursor->position = this->cursors.size();
+            this->cursors.push_back(cursor);
+            if (this->freeHandles.empty()) {
+                index = static_cast<uint32_t>(this->byHandle.size());
+                this->byHandle.emplace_back();
+            } else {
+                index = this->freeHandles.back();
+                this->freeHandles.pop_back();
+            }
+            this->byHandle[index].cursor = move(cursor);
+            generation = this->byHandle[index].generation;
+        }
+        bumpVersion();
+        return PolicySubscription{index, generation};
+    }
+
+    //返回后该观察者不会再被调用；不能在该观察者自己的update里退订自己
+    void unsubscribe(PolicySubscription subscription) {
+        shared_ptr<Cursor> cursor;
+        {
+            lock_guard<mutex> guard(this->listLock);
+            HandleSlot *slot = handleSlot(subscription);
+            if (slot == nullptr) {
+                return;
+            }
+            cursor = move(slot->cursor);
+            ++slot->generation;
+            this->freeHandles.push_back(subscription.index);
+            cursor->active.store(false, memory_order_seq_cst);
+            if (cursor->position + 1 != this->cursors.size()) {
+                this->cursors[cursor->position] = move(this->cursors.back());
+                this->cursors[cursor->position]->position = cursor->position;
+            }
+            this->cursors.pop_back();
+        }
+        bumpVersion();
+        //投递线程看到active已清，放手时会在idleLock下通知，所以这里在锁内检查busy不会错过唤醒
+        unique_lock<mutex> guard(this->idleLock);
+        this->idle.wait(guard, [&] { return !cursor->busy.load(memory_order_seq_cst); });
+    }
+
+    void publish() {
+        {
+            lock_guard<mutex> guard(this->wakeLock);
+            this->sequence.fetch_add(1, memory_order_release);
+        }
+        this->wake.notify_all();
+    }
+
+    uint64_t published() const {
+        return this->sequence.load(memory_order_acquire);
+    }
+
+    //当前落后的tick数
+    uint64_t lag(PolicySubscription subscription) {
+        shared_ptr<Cursor> cursor = find(subscription);
+        return cursor ? published() - cursor->delivered.load(memory_order_acquire) : 0;
+    }
+
+    //开始投递时观察到的最大积压
+    uint64_t maxLag(PolicySubscription subscription) {
+        shared_ptr<Cursor> cursor = find(subscription);
+        return cursor ? cursor->maxLag.load(memory_order_relaxed) : 0;
+    }
+
+    //update/updateRange的调用次数
+    uint64_t calls(PolicySubscription subscription) {
+        shared_ptr<Cursor> cursor = find(subscription);
+        return cursor ? cursor->calls.load(memory_order_relaxed) : 0;
+    }
+
+    ~CursorDispatcher() {
+        {
+            lock_guard<mutex> guard(this->wakeLock);
+            this->stopping = true;
+        }
+        this->wake.notify_all();
+        for (auto &worker: this->workers) {
+            worker.join();
+        }
+    }
+
+private:
+    //句柄已失效（已退订或槽位已复用）时返回nullptr，调用者须持有listLock
+    HandleSlot *handleSlot(PolicySubscription subscription) {
+        if (subscription.index >= this->byHandle.size()) {
+            return nullptr;
+        }
+        HandleSlot &slot = this->byHandle[subscription.index];
+        return slot.cursor && slot.generation == subscription.generation ? &slot : nullptr;
+    }
+
+    shared_ptr<Cursor> find(PolicySubscription subscription) {
+        lock_guard<mutex> guard(this->listLock);
+        HandleSlot *slot = handleSlot(subscription);
+        return slot != nullptr ? slot->cursor : nullptr;
+    }
+};
+
 //具体主题实现
 class Clock : public Subject {
 private:
-    list<Observer *> observers;
+    ObserverRegistry registry;
+    HourIndex filtered;
+    unique_ptr<AsyncNotifier> async;
+    unique_ptr<CursorDispatcher> dispatcher;
+    size_t deliveryThreads = 1;
     int hour;
+
+    //异步模式下修改注册表前先排空在途的tick，保证工作线程看到的分段不变
+    void quiesce() {
+        if (this->async) {
+            this->async->waitIdle();
+        }
+    }
+
 public:
     Clock() : hour(0) {}
 
     void addObserver(Observer *observer) override {
-        this->observers.emplace_back(observer);
+        quiesce();
+        this->registry.subscribe(observer);
     }
 
     void deleteObserver(Observer *observer) override {
-        //删除list中某个元素，用其成员函数remove
-        this->observers.remove(observer);
+        quiesce();
+        this->registry.remove(observer);
+    }
+
+    //知道具体类型时用subscribe，同类观察者会连续存放并免去逐个虚调用
+    template<typename T>
+    Subscription subscribe(T *observer) {
+        quiesce();
+        return this->registry.subscribe(observer);
+    }
+
+    bool unsubscribe(Subscription subscription) {
+        quiesce();
+        return this->registry.unsubscribe(subscription);
+    }
+
+    //只在filter关注的小时收到通知
+    template<typename T>
+    FilteredSubscription subscribe(T *observer, HourFilter filter) {
+        quiesce();
+        return this->filtered.subscribe(observer, filter);
+    }
+
+    bool unsubscribe(FilteredSubscription subscription) {
+        quiesce();
+        return this->filtered.unsubscribe(subscription);
+    }
+
+    //开启异步通知：tick只负责投递，由threads个工作线程并行调用update
+    //observer的update会在工作线程上执行，需要自己保证线程安全；threads为0时恢复同步通知
+    void setAsyncNotification(size_t threads) {
+        this->async.reset();
+        if (threads > 0) {
+            this->async.reset(new AsyncNotifier([this](int hour, size_t part, size_t parts) {
+                this->registry.notifyPart(hour, part, parts);
+                this->filtered.notifyPart(hour, part, parts);
+            }, threads));
+        }
+    }
+
+    //按策略投递的订阅由独立的投递线程服务，第一次subscribe时按deliveryThreads启动
+    void setDeliveryThreads(size_t threads) {
+        if (this->dispatcher) {
+            throw logic_error("delivery threads already started");
+        }
+        this->deliveryThreads = threads;
+    }
+
+    //observer的update/updateRange在投递线程上执行
+    PolicySubscription subscribe(Observer *observer, DeliveryPolicy policy, size_t maxBatch = 64) {
+        if (!this->dispatcher) {
+            this->dispatcher.reset(new CursorDispatcher(this->hour, this->deliveryThreads));
+        }
+        return this->dispatcher->subscribe(observer, policy, maxBatch);
+    }
+
+    void unsubscribe(PolicySubscription subscription) {
+        if (this->dispatcher) {
+            this->dispatcher->unsubscribe(subscription);
+        }
+    }
+
+    CursorDispatcher *getDispatcher() const {
+        return this->dispatcher.get();
+    }
+
+    //完成屏障：等待此前所有tick都通知完毕，同步模式下立即返回
+    void waitForDelivery() {
+        quiesce();
+    }
+
+    void notifyObservers() override {
+        if (this->async) {
+            this->async->post(this->hour);
+        } else {
+            this->registry.notifyAll(this->hour);
+            this->filtered.notify(this->hour);
+        }
+    }
+
+    //同一观察者可能既全量订阅又按小时订阅，或订阅了多次，这里每个只返回一次，调用者可以逐个释放
+    vector<Observer *> getObservers() {
+        quiesce();
+        vector<Observer *> observers;
+        unordered_set<Observer *> seen;
+        auto collect = [&](Observer *observer) {
+            if (seen.insert(observer).second) {
+                observers.push_back(observer);
+            }
+        };
+        this->registry.forEach(collect);
+        this->filtered.forEach(collect);
+        return observers;
+    }
+
+    //更新时间并通知观察者
+    void tick() {
+        this->hour = (this->hour + 1) % 24;
+        notifyObservers();
+        if (this->dispatcher) {
+            this->dispatcher->publish();
+        }
+    }
+
+    //先停掉工作线程（析构时会处理完已投递的tick），再销毁注册表
+    ~Clock() override {
+        this->dispatcher.reset();
+        this->async.reset();
+    }
+};
+
+//基于epoch的回收：读者进入时登记当前epoch，写者换下的旧对象记上退役时的epoch，
+//所有登记中的读者都晚于该epoch（或不在读）之后才释放
+template<typename T>
+class EpochDomain {
+private:
+    static constexpr size_t maxReaders = 64;
+
+    //0表示该槽位空闲；独占一条缓存行，避免读者之间伪共享
+    struct alignas(64) ReaderSlot {
+        atomic<uint64_t> epoch{0};
+    };
+
+    atomic<uint64_t> globalEpoch{1};
+    ReaderSlot readers[maxReaders];
+    vector<pair<uint64_t, unique_ptr<T>>> retired;
+
+    uint64_t oldestActiveEpoch() const {
+        uint64_t oldest = UINT64_MAX;
+        for (const ReaderSlot &reader: this->readers) {
+            uint64_t epoch = reader.epoch.load();
+            if (epoch != 0 && epoch < oldest) {
+                oldest = epoch;
+            }
+        }
+        return oldest;
+    }
+
+public:
+    //读临界区：构造时占一个槽位登记epoch，析构时归还
+    class Guard {
+    private:
+        ReaderSlot *slot;
+    public:
+        explicit Guard(EpochDomain &domain) : slot(nullptr) {
+            for (;;) {
+                for (ReaderSlot &reader: domain.readers) {
+                    uint64_t expected = 0;
+                    if (reader.epoch.load(memory_order_relaxed) == 0 &&
+                        reader.epoch.compare_exchange_strong(expected, domain.globalEpoch.load())) {
+                        this->slot = &reader;
+                        return;
+                    }
+                }
+                //槽位全被占用时让出CPU等别的读者退出
+                this_thread::yield();
+            }
+        }
+
+        Guard(const Guard &) = delete;
+
+        Guard &operator=(const Guard &) = delete;
+
+        ~Guard() {
+            this->slot->epoch.store(0, memory_order_release);
+        }
+    };
+
+    //调用者已把old从共享指针上摘下（seq_cst交换），此后进入的读者只能看到新对象；
+    //retire和reclaim只能由写者在持有写锁时调用
+    void retire(T *old) {
+        uint64_t epoch = this->globalEpoch.fetch_add(1);
+        this->retired.emplace_back(epoch, unique_ptr<T>(old));
+    }
+
+    //释放所有读者都已不可能再访问的旧对象
+    void reclaim() {
+        uint64_t oldest = oldestActiveEpoch();
+        size_t kept = 0;
+        for (auto &entry: this->retired) {
+            if (entry.first >= oldest) {
+                this->retired[kept++] = move(entry);
+            }
+        }
+        this->retired.resize(kept);
+    }
+
+    //宽限期：等到此刻之前进入的读者全部退出；只读原子变量，不需要写锁
+    void synchronize() {
+        uint64_t epoch = this->globalEpoch.fetch_add(1);
+        while (oldestActiveEpoch() <= epoch) {
+            this_thread::yield();
+        }
+    }
+
+    size_t retiredCount() const {
+        return this->retired.size();
+    }
+};
+
+//不可变的观察者快照：分块存放，修改时只复制被改动的块，其余块与旧快照共享
+struct ObserverChunk {
+    static constexpr size_t capacity = 4096;
+    vector<Observer *> observers;
+};
+
+struct ObserverSnapshot {
+    vector<shared_ptr<const ObserverChunk>> chunks;
+    size_t size = 0;
+};
+
+//读写并发安全的主题：通知遍历不可变快照，不加锁；订阅变更在写锁内生成新快照再原子发布
+//同一观察者重复订阅会被忽略；退订用swap-remove，之后通知顺序不再是订阅顺序
+//deleteObserver返回后，进行中的通知仍可能调用该观察者，释放观察者前要先调用synchronize
+//tick只能由一个线程调用
+class SnapshotClock : public Subject {
+private:
+    atomic<ObserverSnapshot *> current;
+    EpochDomain<ObserverSnapshot> epochs;
+    mutex writerLock;
+    unordered_map<Observer *, size_t> positions;
+    int hour;
+
+    static shared_ptr<ObserverChunk> copyChunk(const ObserverSnapshot &snapshot, size_t index) {
+        return make_shared<ObserverChunk>(*snapshot.chunks[index]);
+    }
+
+    void publish(ObserverSnapshot *next) {
+        ObserverSnapshot *old = this->current.exchange(next);
+        this->epochs.retire(old);
+        this->epochs.reclaim();
+    }
+
+public:
+    SnapshotClock() : current(new ObserverSnapshot()), hour(0) {}
+
+    SnapshotClock(const SnapshotClock &) = delete;
+
+    SnapshotClock &operator=(const SnapshotClock &) = delete;
+
+    void addObserver(Observer *observer) override {
+        lock_guard<mutex> guard(this->writerLock);
+        if (!this->positions.emplace(observer, 0).second) {
+            return;
+        }
+        const ObserverSnapshot &snapshot = *this->current.load();
+        auto *next = new ObserverSnapshot(snapshot);
+        size_t position = snapshot.size;
+        if (position % ObserverChunk::capacity == 0) {
+            auto chunk = make_shared<ObserverChunk>();
+            chunk->observers.reserve(ObserverChunk::capacity);
+            chunk->observers.push_back(observer);
+            next->chunks.push_back(move(chunk));
+        } else {
+            auto chunk = copyChunk(snapshot, next->chunks.size() - 1);
+            chunk->observers.push_back(observer);
+            next->chunks.back() = move(chunk);
+        }
+        next->size = position + 1;
+        this->positions[observer] = position;
+        publish(next);
+    }
+
+    void deleteObserver(Observer *observer) override {
+        lock_guard<mutex> guard(this->writerLock);
+        auto it = this->positions.find(observer);
+        if (it == this->positions.end()) {
+            return;
+        }
+        size_t position = it->second;
+        this->positions.erase(it);
+        const ObserverSnapshot &snapshot = *this->current.load();
+        auto *next = new ObserverSnapshot(snapshot);
+        size_t last = snapshot.size - 1;
+        size_t lastChunk = last / ObserverChunk::capacity;
+        //用末尾元素填补空位，最多复制两个块
+        if (position != last) {
+            Observer *moved = snapshot.chunks[lastChunk]->observers.back();
+            size_t chunkIndex = position / ObserverChunk::capacity;
+            auto chunk = copyChunk(snapshot, chunkIndex);
+            chunk->observers[position % ObserverChunk::capacity] = moved;
+            next->chunks[chunkIndex] = move(chunk);
+            this->positions[moved] = position;
+        }
+        if (last % ObserverChunk::capacity == 0) {
+            next->chunks.pop_back();
+        } else {
+            auto chunk = make_shared<ObserverChunk>(*next->chunks[lastChunk]);
+            chunk->observers.pop_back();
+            next->chunks[lastChunk] = move(chunk);
+        }
+        next->size = last;
+        publish(next);
+    }
+
+    //等待宽限期：返回后，此前已退订的观察者不会再被任何通知调用，可以安全释放
+    //等待期间不持有写锁，所以观察者在update里订阅/退订不会与之死锁；但不能在update里调用synchronize
+    void synchronize() {
+        this->epochs.synchronize();
+        lock_guard<mutex> guard(this->writerLock);
+        this->epochs.reclaim();
     }
 
     void notifyObservers() override {
-        for (auto observer: this->observers) {
-            observer->update(this->hour);
+        EpochDomain<ObserverSnapshot>::Guard guard(this->epochs);
+        const ObserverSnapshot *snapshot = this->current.load();
+        for (const auto &chunk: snapshot->chunks) {
+            for (Observer *observer: chunk->observers) {
+                observer->update(this->hour);
+            }
         }
     }
 
-    const list<Observer *> &getObservers() const {
-        return this->observers;
+    vector<Observer *> getObservers() {
+        EpochDomain<ObserverSnapshot>::Guard guard(this->epochs);
+        const ObserverSnapshot *snapshot = this->current.load();
+        vector<Observer *> observers;
+        observers.reserve(snapshot->size);
+        for (const auto &chunk: snapshot->chunks) {
+            observers.insert(observers.end(), chunk->observers.begin(), chunk->observers.end());
+        }
+        return observers;
     }
 
     //更新时间并通知观察者
@@ -69,7 +1134,10 @@ public:
         notifyObservers();
     }
 
-    ~Clock() override = default;
+    //析构时不能再有并发的通知和订阅变更，剩余的旧快照由epochs析构释放
+    ~SnapshotClock() override {
+        delete this->current.load();
+    }
 };
 
 //具体观察者实现
@@ -80,18 +1148,21 @@ public:
     explicit Student(const string &name) : name(name) {}
 
     void update(int hour) override {
-        cout << this->name << ' ' << hour << endl;
+        cout << this->name << ' ' << hour << '\n';
     }
 };
 
 int main() {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
     int N;
     cin >> N;
     Clock clock;
     while (N--) {
         string name;
         cin >> name;
-        clock.addObserver(new Student(name));
+        //以具体类型订阅，所有Student连续存放在同一分组里
+        clock.subscribe(new Student(name));
     }
 
     int updates;
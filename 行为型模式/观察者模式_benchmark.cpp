@@ -0,0 +1,513 @@
+/* 观察者模式的基准测试。
+ * async：Clock异步并行通知在1到32个投递线程下的单tick延迟与吞吐。
+ *   io-bound：200个观察者，每次update阻塞50us（模拟I/O），同时检查每个观察者收到的hour是否连续；
+ *   cpu-bound：2e5个观察者，每次update做一段纯计算。
+ * snapshot：1e5个观察者时单次tick的延迟分布，对比Clock、无改动的SnapshotClock、
+ *   另一线程不停订阅/退订时的SnapshotClock，以及另一线程只做空转的对照组（区分改动本身与分时抢占的影响）。
+ * fanout：1e6个观察者时单次tick的耗时，对比原来list<Observer*>的Clock、按基类指针addObserver的注册表
+ *   与按具体类型subscribe的注册表；再比较随机退订后重新订阅（churn）的单次耗时，以及churn之后的tick耗时。
+ * policies：1000个快观察者与20个慢观察者（每次调用睡眠2ms）混合，每200us一个tick。
+ *   先给出慢观察者同步挂在Clock上时的tick耗时作为对照，再对慢观察者分别使用EveryEvent、LatestOnly、Batched(64)，
+ *   4个投递线程，统计tick线程每次tick的CPU时间、快观察者的最大积压与送达比例、慢观察者的调用次数与积压，
+ *   并检查每个观察者收到的hour是否连续（LatestOnly允许跳过）。
+ * filter：1e6个订阅，每个随机关注1、3或12个小时。对比订阅全部小时、在update里自己判断的做法
+ *   与按小时倒排索引的过滤订阅，给出每tick耗时、单次订阅耗时与随机退订再订阅的耗时，并核对两边累计的结果相同。
+ * 编译：g++ -std=c++17 -O2 -pthread 观察者模式_benchmark.cpp
+ * 用法：观察者模式_benchmark [async|snapshot|fanout|policies|filter] [tick数，async默认20，snapshot默认2000，fanout默认50，
+ *       policies默认5000，filter默认96]
+ */
+//复用模式程序中的类，程序自己的main改名后不使用
+#define main observerProgramMain
+#include "观察者模式.cpp"
+#undef main
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <time.h>
+
+using BenchClock = chrono::steady_clock;
+
+class BlockingObserver final : public Observer {
+private:
+    int last = 0;
+    bool ordered = true;
+public:
+    void update(int hour) override {
+        if (hour != (this->last + 1) % 24) {
+            this->ordered = false;
+        }
+        this->last = hour;
+        this_thread::sleep_for(chrono::microseconds(50));
+    }
+
+    bool receivedInOrder() const {
+        return this->ordered;
+    }
+
+    //新的Clock从1点开始
+    void reset() {
+        this->last = 0;
+    }
+};
+
+class ComputingObserver final : public Observer {
+private:
+    long long state = 0;
+public:
+    void update(int hour) override {
+        for (int i = 0; i < 200; ++i) {
+            this->state = this->state * 31 + hour;
+        }
+    }
+};
+
+double millisSince(BenchClock::time_point start) {
+    return chrono::duration<double, milli>(BenchClock::now() - start).count();
+}
+
+//threads为0表示同步通知
+void benchmarkAsync(int ticks) {
+    vector<unique_ptr<BlockingObserver>> blocking;
+    for (int i = 0; i < 200; ++i) {
+        blocking.emplace_back(new BlockingObserver());
+    }
+    vector<unique_ptr<ComputingObserver>> computing;
+    for (int i = 0; i < 200000; ++i) {
+        computing.emplace_back(new ComputingObserver());
+    }
+    printf("threads  io latency/tick  io ticks/s  cpu-bound ms/tick  ordered\n");
+    for (size_t threads : {0, 1, 2, 4, 8, 16, 32}) {
+        bool ordered = true;
+        double latency, throughput, cpuMillis;
+        {
+            Clock clock;
+            for (auto &observer: blocking) {
+                observer->reset();
+                clock.subscribe(observer.get());
+            }
+            if (threads > 0) {
+                clock.setAsyncNotification(threads);
+            }
+            //延迟：每次tick后立刻等待完成屏障
+            auto start = BenchClock::now();
+            for (int i = 0; i < ticks; ++i) {
+                clock.tick();
+                clock.waitForDelivery();
+            }
+            latency = millisSince(start) / ticks;
+            //吞吐：连续投递，最后只等一次屏障
+            start = BenchClock::now();
+            for (int i = 0; i < ticks; ++i) {
+                clock.tick();
+            }
+            clock.waitForDelivery();
+            throughput = ticks * 1000.0 / millisSince(start);
+            for (auto &observer: blocking) {
+                ordered = ordered && observer->receivedInOrder();
+            }
+        }
+        {
+            Clock clock;
+            for (auto &observer: computing) {
+                clock.subscribe(observer.get());
+            }
+            if (threads > 0) {
+                clock.setAsyncNotification(threads);
+            }
+            auto start = BenchClock::now();
+            for (int i = 0; i < ticks; ++i) {
+                clock.tick();
+            }
+            clock.waitForDelivery();
+            cpuMillis = millisSince(start) / ticks;
+        }
+        printf("%7s  %12.2f ms  %10.1f  %17.2f  %7s\n", threads == 0 ? "sync" : to_string(threads).c_str(),
+               latency, throughput, cpuMillis, ordered ? "yes" : "NO");
+    }
+}
+
+class CountingObserver final : public Observer {
+private:
+    long long sum = 0;
+public:
+    void update(int hour) override {
+        this->sum += hour;
+    }
+};
+
+template<typename Subject>
+void printTickLatency(const char *name, Subject &clock, int ticks) {
+    vector<double> micros;
+    micros.reserve(ticks);
+    for (int i = 0; i < ticks; ++i) {
+        auto start = BenchClock::now();
+        clock.tick();
+        micros.push_back(chrono::duration<double, micro>(BenchClock::now() - start).count());
+    }
+    sort(micros.begin(), micros.end());
+    printf("%-28s p50 %8.1f us  p99 %8.1f us  max %8.1f us\n", name, micros[ticks / 2], micros[ticks * 99 / 100], micros.back());
+}
+
+void benchmarkSnapshot(int ticks) {
+    vector<unique_ptr<CountingObserver>> observers;
+    for (int i = 0; i < 100000; ++i) {
+        observers.emplace_back(new CountingObserver());
+    }
+    Clock plain;
+    for (auto &observer: observers) {
+        plain.addObserver(observer.get());
+    }
+    printTickLatency("Clock (registry)", plain, ticks);
+
+    SnapshotClock snapshot;
+    for (auto &observer: observers) {
+        snapshot.addObserver(observer.get());
+    }
+    printTickLatency("SnapshotClock, no churn", snapshot, ticks);
+
+    //改动线程反复订阅再退订一组额外的观察者
+    vector<unique_ptr<CountingObserver>> extra;
+    for (int i = 0; i < 1000; ++i) {
+        extra.emplace_back(new CountingObserver());
+    }
+    atomic<bool> stop{false};
+    atomic<long> operations{0};
+    auto start = BenchClock::now();
+    thread churn([&] {
+        mt19937 rng(1);
+        while (!stop.load()) {
+            Observer *observer = extra[rng() % extra.size()].get();
+            snapshot.addObserver(observer);
+            snapshot.deleteObserver(observer);
+            operations.fetch_add(2, memory_order_relaxed);
+        }
+    });
+    printTickLatency("SnapshotClock + churn", snapshot, ticks);
+    stop.store(true);
+    churn.join();
+    printf("  churn rate: %.0f subscription ops/s\n", operations.load() * 1000.0 / millisSince(start));
+
+    //对照组：另一线程只空转，不碰clock
+    stop.store(false);
+    thread busy([&] {
+        volatile long spins = 0;
+        while (!stop.load(memory_order_relaxed)) {
+            spins = spins + 1;
+        }
+    });
+    printTickLatency("SnapshotClock + busy loop", snapshot, ticks);
+    stop.store(true);
+    busy.join();
+    snapshot.synchronize();
+}
+
+//原来的主题：观察者存放在list中，退订用list::remove线性查找
+class ListClock : public Subject {
+private:
+    list<Observer *> observers;
+    int hour = 0;
+public:
+    void addObserver(Observer *observer) override {
+        this->observers.emplace_back(observer);
+    }
+
+    void deleteObserver(Observer *observer) override {
+        this->observers.remove(observer);
+    }
+
+    void notifyObservers() override {
+        for (auto observer: this->observers) {
+            observer->update(this->hour);
+        }
+    }
+
+    void tick() {
+        this->hour = (this->hour + 1) % 24;
+        notifyObservers();
+    }
+};
+
+template<typename Subject>
+double millisPerTick(Subject &clock, int ticks) {
+    auto start = BenchClock::now();
+    for (int i = 0; i < ticks; ++i) {
+        clock.tick();
+    }
+    return millisSince(start) / ticks;
+}
+
+void benchmarkFanout(int ticks) {
+    const size_t count = 1000000;
+    //两组观察者交替分配，模拟真实程序中分散在堆上的对象
+    vector<unique_ptr<CountingObserver>> observers, listObservers;
+    for (size_t i = 0; i < count; ++i) {
+        observers.emplace_back(new CountingObserver());
+        listObservers.emplace_back(new CountingObserver());
+    }
+
+    ListClock listClock;
+    for (auto &observer: listObservers) {
+        listClock.addObserver(observer.get());
+    }
+    Clock generic;
+    for (auto &observer: observers) {
+        generic.addObserver(observer.get());
+    }
+    Clock typed;
+    vector<Subscription> handles;
+    for (auto &observer: observers) {
+        handles.push_back(typed.subscribe(observer.get()));
+    }
+    printf("%zu observers, ms/tick\n", count);
+    printf("list<Observer*>:              %6.2f\n", millisPerTick(listClock, ticks));
+    printf("registry, addObserver:        %6.2f\n", millisPerTick(generic, ticks));
+    printf("registry, typed subscribe:    %6.2f\n", millisPerTick(typed, ticks));
+
+    //随机挑一个观察者退订再重新订阅；list的退订是线性查找，只做少量几次
+    mt19937 rng(1);
+    const int registryChurn = 100000;
+    auto start = BenchClock::now();
+    for (int i = 0; i < registryChurn; ++i) {
+        size_t victim = rng() % count;
+        typed.unsubscribe(handles[victim]);
+        handles[victim] = typed.subscribe(observers[victim].get());
+    }
+    double registryNanos = millisSince(start) * 1e6 / registryChurn;
+    const int listChurn = 200;
+    start = BenchClock::now();
+    for (int i = 0; i < listChurn; ++i) {
+        Observer *victim = listObservers[rng() % count].get();
+        listClock.deleteObserver(victim);
+        listClock.addObserver(victim);
+    }
+    double listNanos = millisSince(start) * 1e6 / listChurn;
+    printf("churn (unsubscribe + resubscribe): registry %.0f ns/op over %d ops, list %.0f ns/op over %d ops\n",
+           registryNanos, registryChurn, listNanos, listChurn);
+    printf("registry tick after churn:    %6.2f ms\n", millisPerTick(typed, ticks));
+}
+
+//当前线程已使用的CPU时间，微秒
+double threadCpuMicros() {
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+//检查收到的hour是否接着上一次；sleepMicros不为0时每次调用睡眠这么久，模拟慢的消费者
+class PacedObserver final : public Observer {
+private:
+    int next = -1;
+    bool ordered = true;
+    bool allowGaps;
+    int sleepMicros;
+    long long events = 0;
+
+    void receive(int firstHour, size_t count) {
+        if (this->next >= 0 && !this->allowGaps && firstHour != this->next) {
+            this->ordered = false;
+        }
+        this->next = static_cast<int>((firstHour + count) % 24);
+        this->events += static_cast<long long>(count);
+        if (this->sleepMicros > 0) {
+            this_thread::sleep_for(chrono::microseconds(this->sleepMicros));
+        }
+    }
+public:
+    PacedObserver(bool allowGaps, int sleepMicros) : allowGaps(allowGaps), sleepMicros(sleepMicros) {}
+
+    void update(int hour) override {
+        receive(hour, 1);
+    }
+
+    void updateRange(int firstHour, size_t count) override {
+        receive(firstHour, count);
+    }
+
+    bool receivedInOrder() const {
+        return this->ordered;
+    }
+
+    long long received() const {
+        return this->events;
+    }
+};
+
+void benchmarkPolicies(int ticks) {
+    const int fastCount = 1000, slowCount = 20, slowMicros = 2000, paceMicros = 200;
+    {
+        //对照：慢观察者同步挂在Clock上，每个tick都要等它们全部返回
+        Clock clock;
+        vector<unique_ptr<PacedObserver>> observers;
+        for (int i = 0; i < fastCount + slowCount; ++i) {
+            observers.emplace_back(new PacedObserver(false, i < fastCount ? 0 : slowMicros));
+            clock.subscribe(observers.back().get());
+        }
+        const int syncTicks = 50;
+        double cpu = threadCpuMicros();
+        auto start = BenchClock::now();
+        for (int i = 0; i < syncTicks; ++i) {
+            clock.tick();
+        }
+        printf("synchronous: %.0f us wall, %.1f us CPU per tick (fast observers wait behind the slow ones)\n",
+               millisSince(start) * 1e3 / syncTicks, (threadCpuMicros() - cpu) / syncTicks);
+    }
+    const pair<const char *, DeliveryPolicy> policies[] = {{"EveryEvent", DeliveryPolicy::EveryEvent},
+                                                           {"LatestOnly", DeliveryPolicy::LatestOnly},
+                                                           {"Batched(64)", DeliveryPolicy::Batched}};
+    printf("%d ticks every %d us, %d fast + %d slow observers, 4 delivery threads\n", ticks, paceMicros, fastCount,
+           slowCount);
+    for (auto &[name, policy]: policies) {
+        Clock clock;
+        clock.setDeliveryThreads(4);
+        vector<unique_ptr<PacedObserver>> fast, slow;
+        vector<PolicySubscription> fastHandles, slowHandles;
+        for (int i = 0; i < fastCount; ++i) {
+            fast.emplace_back(new PacedObserver(false, 0));
+            fastHandles.push_back(clock.subscribe(fast.back().get(), DeliveryPolicy::EveryEvent));
+        }
+        for (int i = 0; i < slowCount; ++i) {
+            slow.emplace_back(new PacedObserver(policy == DeliveryPolicy::LatestOnly, slowMicros));
+            slowHandles.push_back(clock.subscribe(slow.back().get(), policy, 64));
+        }
+        CursorDispatcher *dispatcher = clock.getDispatcher();
+        double tickCpu = 0;
+        auto start = BenchClock::now();
+        for (int i = 0; i < ticks; ++i) {
+            double cpu = threadCpuMicros();
+            clock.tick();
+            tickCpu += threadCpuMicros() - cpu;
+            this_thread::sleep_until(start + chrono::microseconds(paceMicros * (i + 1)));
+        }
+        uint64_t fastMaxLag = 0, slowMaxLag = 0, slowLagAtEnd = 0, slowCalls = 0;
+        for (auto handle: fastHandles) {
+            fastMaxLag = max(fastMaxLag, dispatcher->maxLag(handle));
+        }
+        for (auto handle: slowHandles) {
+            slowMaxLag = max(slowMaxLag, dispatcher->maxLag(handle));
+            slowLagAtEnd = max(slowLagAtEnd, dispatcher->lag(handle));
+            slowCalls += dispatcher->calls(handle);
+        }
+        bool ordered = true;
+        long long fastEvents = 0;
+        for (auto &observer: fast) {
+            ordered = ordered && observer->receivedInOrder();
+            fastEvents += observer->received();
+        }
+        for (auto &observer: slow) {
+            ordered = ordered && observer->receivedInOrder();
+        }
+        printf("%-12s tick CPU %5.2f us | fast: max lag %3llu ticks, %5.1f%% delivered | "
+               "slow: %5.0f calls each, max lag %4llu, lag at end %4llu | %s\n", name, tickCpu / ticks,
+               static_cast<unsigned long long>(fastMaxLag), 100.0 * fastEvents / (static_cast<double>(fastCount) * ticks),
+               static_cast<double>(slowCalls) / slowCount, static_cast<unsigned long long>(slowMaxLag),
+               static_cast<unsigned long long>(slowLagAtEnd), ordered ? "in order" : "OUT OF ORDER");
+        //慢观察者积压了大量tick，先退订，避免析构时等它们补完
+        for (auto handle: slowHandles) {
+            clock.unsubscribe(handle);
+        }
+    }
+}
+
+//只在关注的小时累加；filtered为false时订阅全部小时，由update自己按掩码判断
+class MaskedObserver final : public Observer {
+private:
+    uint32_t mask;
+    bool filtered;
+    long long sum = 0;
+public:
+    MaskedObserver(uint32_t mask, bool filtered) : mask(mask), filtered(filtered) {}
+
+    void update(int hour) override {
+        if (this->filtered || (this->mask >> hour & 1u) != 0) {
+            this->sum += hour;
+        }
+    }
+
+    uint32_t hours() const {
+        return this->mask;
+    }
+
+    long long total() const {
+        return this->sum;
+    }
+};
+
+void benchmarkFilter(int ticks) {
+    const size_t count = 1000000;
+    const int churn = 100000;
+    mt19937 rng(7);
+    printf("%zu subscriptions, %d ticks\n", count, ticks);
+    for (int hoursEach: {1, 3, 12}) {
+        vector<unique_ptr<MaskedObserver>> selfFiltering, indexed;
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t mask = 0;
+            while (__builtin_popcount(mask) < hoursEach) {
+                mask |= 1u << (rng() % 24);
+            }
+            selfFiltering.emplace_back(new MaskedObserver(mask, false));
+            indexed.emplace_back(new MaskedObserver(mask, true));
+        }
+
+        Clock everyHour;
+        for (auto &observer: selfFiltering) {
+            everyHour.subscribe(observer.get());
+        }
+        double everyHourMillis = millisPerTick(everyHour, ticks);
+
+        Clock byHour;
+        vector<FilteredSubscription> handles;
+        handles.reserve(count);
+        auto start = BenchClock::now();
+        for (auto &observer: indexed) {
+            handles.push_back(byHour.subscribe(observer.get(), HourFilter::fromMask(observer->hours())));
+        }
+        double subscribeNanos = millisSince(start) * 1e6 / count;
+        double indexedMillis = millisPerTick(byHour, ticks);
+
+        start = BenchClock::now();
+        for (int i = 0; i < churn; ++i) {
+            size_t victim = rng() % count;
+            byHour.unsubscribe(handles[victim]);
+            handles[victim] = byHour.subscribe(indexed[victim].get(), HourFilter::fromMask(indexed[victim]->hours()));
+        }
+        double churnNanos = millisSince(start) * 1e6 / churn;
+
+        long long selfSum = 0, indexedSum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            selfSum += selfFiltering[i]->total();
+            indexedSum += indexed[i]->total();
+        }
+        printf("%2d hours each (~%6.0f interested per tick): every hour + self filter %7.2f ms/tick, "
+               "hour index %6.2f ms/tick (%4.1fx) | subscribe %3.0f ns, churn %4.0f ns/op | %s\n", hoursEach,
+               count * hoursEach / 24.0, everyHourMillis, indexedMillis, everyHourMillis / indexedMillis, subscribeNanos,
+               churnNanos, selfSum == indexedSum ? "results match" : "RESULTS DIFFER");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    string mode = argc > 1 ? argv[1] : "async";
+    if (mode == "async") {
+        benchmarkAsync(argc > 2 ? max(atoi(argv[2]), 1) : 20);
+        return 0;
+    }
+    if (mode == "snapshot") {
+        benchmarkSnapshot(argc > 2 ? max(atoi(argv[2]), 100) : 2000);
+        return 0;
+    }
+    if (mode == "fanout") {
+        benchmarkFanout(argc > 2 ? max(atoi(argv[2]), 1) : 50);
+        return 0;
+    }
+    if (mode == "policies") {
+        benchmarkPolicies(argc > 2 ? max(atoi(argv[2]), 1) : 5000);
+        return 0;
+    }
+    if (mode == "filter") {
+        benchmarkFilter(argc > 2 ? max(atoi(argv[2]), 1) : 96);
+        return 0;
+    }
+    fprintf(stderr, "unknown benchmark: %s\n", mode.c_str());
+    return 1;
+}
@@ -0,0 +1,111 @@
+/* SnapshotClock回收安全性的压力测试。
+ * 一个线程不停地tick，2000个固定观察者始终在册；4个改动线程各自持有500个观察者，反复退订其中一个，
+ * 四分之一的情况下立刻重新订阅同一个对象，其余情况下synchronize()等过宽限期后把它标记为已死并delete，再订阅一个新的。
+ * 宽限期之后已死的观察者不应再被调用：调用到它时计一次违例（在ASan下还会报use-after-free）。
+ * 结束时最终快照必须与各线程持有的观察者集合完全一致。有违例或集合不一致时返回1。
+ * 编译：g++ -std=c++17 -O2 -pthread 观察者模式_stress.cpp （也可加-fsanitize=address或thread）
+ * 用法：观察者模式_stress [秒数，默认3]
+ */
+//复用模式程序中的类，程序自己的main改名后不使用
+#define main observerProgramMain
+#include "观察者模式.cpp"
+#undef main
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+
+atomic<long> violations{0};
+atomic<long> calls{0};
+atomic<long> operations{0};
+
+class ProbeObserver final : public Observer {
+private:
+    atomic<bool> alive{true};
+public:
+    void update(int) override {
+        if (!this->alive.load()) {
+            violations.fetch_add(1);
+        }
+        calls.fetch_add(1, memory_order_relaxed);
+    }
+
+    void kill() {
+        this->alive.store(false);
+    }
+};
+
+int main(int argc, char *argv[]) {
+    int seconds = argc > 1 ? max(atoi(argv[1]), 1) : 3;
+    const int churnThreads = 4;
+    SnapshotClock clock;
+    vector<ProbeObserver *> fixed;
+    for (int i = 0; i < 2000; ++i) {
+        fixed.push_back(new ProbeObserver());
+        clock.addObserver(fixed.back());
+    }
+
+    atomic<bool> stop{false};
+    thread ticker([&] {
+        while (!stop.load()) {
+            clock.tick();
+        }
+    });
+    vector<vector<ProbeObserver *>> owned(churnThreads);
+    vector<thread> churn;
+    for (int t = 0; t < churnThreads; ++t) {
+        churn.emplace_back([&, t] {
+            mt19937 rng(t);
+            vector<ProbeObserver *> &mine = owned[t];
+            for (int i = 0; i < 500; ++i) {
+                mine.push_back(new ProbeObserver());
+                clock.addObserver(mine.back());
+            }
+            while (!stop.load()) {
+                size_t k = rng() % mine.size();
+                ProbeObserver *old = mine[k];
+                clock.deleteObserver(old);
+                operations.fetch_add(1, memory_order_relaxed);
+                if (rng() % 4 == 0) {
+                    clock.addObserver(old);
+                    continue;
+                }
+                clock.synchronize();
+                old->kill();
+                this_thread::yield();
+                delete old;
+                mine[k] = new ProbeObserver();
+                clock.addObserver(mine[k]);
+            }
+        });
+    }
+
+    this_thread::sleep_for(chrono::seconds(seconds));
+    stop.store(true);
+    ticker.join();
+    for (auto &thread: churn) {
+        thread.join();
+    }
+
+    set<Observer *> expected(fixed.begin(), fixed.end());
+    for (auto &mine: owned) {
+        expected.insert(mine.begin(), mine.end());
+    }
+    vector<Observer *> observers = clock.getObservers();
+    set<Observer *> actual(observers.begin(), observers.end());
+    bool sameSet = observers.size() == expected.size() && actual == expected;
+    printf("operations %ld, update calls %ld, calls on dead observers %ld, final snapshot %s\n",
+           operations.load(), calls.load(), violations.load(), sameSet ? "matches" : "MISMATCH");
+
+    clock.synchronize();
+    for (auto *observer: fixed) {
+        delete observer;
+    }
+    for (auto &mine: owned) {
+        for (auto *observer: mine) {
+            delete observer;
+        }
+    }
+    return violations.load() == 0 && sameSet ? 0 : 1;
+}
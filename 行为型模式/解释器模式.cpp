@@ -1,9 +1,15 @@
 #include <iostream>
 #include <stack>
 #include <vector>
-#include <sstream>
-#include <iterator>
-#include <regex>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <exception>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 
 /*
@@ -17,10 +23,304 @@
  * 上下文（Context）： 包含解释器之外的一些全局信息，可存储解释器中间结果，也可向解释器传递信息。
  * */
 
+//字节码指令：Push压入常量；Load压入变量（操作数是上下文中的槽位）；Add/Multiply弹出两个值再压回结果；
+//Raise对应运算符被当作操作数解释的情况，执行到时抛出与OperatorExpression::interpret相同的错误
+enum class OpCode:unsigned char{
+    Push,
+    Load,
+    Add,
+    Multiply,
+    Raise
+};
+
+struct Instruction{
+    OpCode code;
+    int operand;
+};
+
+//与原先int直接相加相乘的结果一致：按二进制补码回绕，但不触发有符号溢出的未定义行为
+inline int wrapAdd(int a, int b){
+    return static_cast<int>(static_cast<unsigned>(a)+static_cast<unsigned>(b));
+}
+
+inline int wrapMultiply(int a, int b){
+    return static_cast<int>(static_cast<unsigned>(a)*static_cast<unsigned>(b));
+}
+
+//上下文：每个声明过的变量名占一个槽位，并保存各槽位当前的取值（供AST逐行解释）；
+//分词时只有声明过的名字才被当作变量，不传上下文时名字仍是非法元素，与原来一致
+class Context{
+private:
+    std::vector<std::string> names;
+    std::vector<int> values;
+public:
+    //重复声明返回原来的槽位
+    size_t declare(const std::string& name){
+        int slot=find(name);
+        if (slot>=0){
+            return slot;
+        }
+        this->names.push_back(name);
+        this->values.push_back(0);
+        return this->names.size()-1;
+    }
+
+    //未声明时返回-1
+    int find(std::string_view name) const{
+        for (size_t i=0; i<this->names.size(); ++i) {
+            if (this->names[i]==name){
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    void set(size_t slot, int value){
+        this->values[slot]=value;
+    }
+
+    int get(size_t slot) const{
+        return this->values[slot];
+    }
+
+    const int* data() const{
+        return this->values.data();
+    }
+
+    size_t size() const{
+        return this->names.size();
+    }
+};
+
+//列运算内核：dst[i]=a[i] op b[i]，结果按补码回绕；某行溢出int时把overflow[i]置为-1（只置位不清零）
+//dst可以与a或b是同一块内存
+inline void addColumns(const int* a, const int* b, int* dst, int* overflow, size_t count){
+    size_t i=0;
+#if defined(__SSE2__)
+    for (; i+4<=count; i+=4) {
+        __m128i x=_mm_loadu_si128(reinterpret_cast<const __m128i*>(a+i));
+        __m128i y=_mm_loadu_si128(reinterpret_cast<const __m128i*>(b+i));
+        __m128i sum=_mm_add_epi32(x, y);
+        //两个加数同号而和的符号与之相反时溢出，即(x^sum)&(y^sum)的符号位
+        __m128i flag=_mm_srai_epi32(_mm_and_si128(_mm_xor_si128(x, sum), _mm_xor_si128(y, sum)), 31);
+        __m128i previous=_mm_loadu_si128(reinterpret_cast<const __m128i*>(overflow+i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+i), sum);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(overflow+i), _mm_or_si128(previous, flag));
+    }
+#endif
+    for (; i<count; ++i) {
+        int x=a[i];
+        int y=b[i];
+        int sum=wrapAdd(x, y);
+        dst[i]=sum;
+        overflow[i]|=((x^sum)&(y^sum))>>31;
+    }
+}
+
+inline void multiplyColumns(const int* a, const int* b, int* dst, int* overflow, size_t count){
+    size_t i=0;
+#if defined(__SSE2__)
+    //SSE2没有32位有符号乘法，用_mm_mul_epu32分别算偶数、奇数通道的64位无符号积，
+    //低32位就是回绕后的结果；高32位减去 (a<0?b:0)+(b<0?a:0) 得到有符号积的高32位，
+    //它不等于低32位的符号扩展时说明溢出
+    for (; i+4<=count; i+=4) {
+        __m128i x=_mm_loadu_si128(reinterpret_cast<const __m128i*>(a+i));
+        __m128i y=_mm_loadu_si128(reinterpret_cast<const __m128i*>(b+i));
+        __m128i even=_mm_mul_epu32(x, y);
+        __m128i odd=_mm_mul_epu32(_mm_srli_epi64(x, 32), _mm_srli_epi64(y, 32));
+        __m128i low=_mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                       _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+        __m128i high=_mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 3, 1)),
+                                        _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 3, 1)));
+        __m128i correction=_mm_add_epi32(_mm_and_si128(_mm_srai_epi32(x, 31), y),
+                                         _mm_and_si128(_mm_srai_epi32(y, 31), x));
+        high=_mm_sub_epi32(high, correction);
+        __m128i flag=_mm_xor_si128(_mm_cmpeq_epi32(high, _mm_srai_epi32(low, 31)), _mm_set1_epi32(-1));
+        __m128i previous=_mm_loadu_si128(reinterpret_cast<const __m128i*>(overflow+i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst+i), low);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(overflow+i), _mm_or_si128(previous, flag));
+    }
+#endif
+    for (; i<count; ++i) {
+        long long product=static_cast<long long>(a[i])*b[i];
+        int result=wrapMultiply(a[i], b[i]);
+        dst[i]=result;
+        overflow[i]|=-static_cast<int>(product!=result);
+    }
+}
+
+//编译后的表达式：后缀顺序的栈字节码，求值是一个紧凑的循环，没有虚调用和堆上的节点
+class CompiledExpression{
+private:
+    std::vector<Instruction> code;
+    int depth=0;
+    int maxDepth=0;
+    //用到的最大变量槽位+1
+    size_t slots=0;
+
+    void grow(){
+        if (++this->depth>this->maxDepth){
+            this->maxDepth=this->depth;
+        }
+    }
+
+public:
+    //清空后可复用已分配的指令缓冲
+    void clear(){
+        this->code.clear();
+        this->depth=0;
+        this->maxDepth=0;
+        this->slots=0;
+    }
+
+    void emitPush(int value){
+        this->code.push_back(Instruction{OpCode::Push, value});
+        grow();
+    }
+
+    void emitLoad(size_t slot){
+        this->code.push_back(Instruction{OpCode::Load, static_cast<int>(slot)});
+        this->slots=std::max(this->slots, slot+1);
+        grow();
+    }
+
+    //Raise占一个操作数的位置，执行到它时直接抛出
+    void emitRaise(){
+        this->code.push_back(Instruction{OpCode::Raise, 0});
+        grow();
+    }
+
+    void emitBinary(OpCode op){
+        this->code.push_back(Instruction{op, 0});
+        --this->depth;
+    }
+
+    size_t size() const{
+        return this->code.size();
+    }
+
+    //占用的内存（对象本身加指令缓冲），缓存按它计算预算
+    size_t memoryBytes() const{
+        return sizeof(*this)+this->code.capacity()*sizeof(Instruction);
+    }
+
+    size_t variableCount() const{
+        return this->slots;
+    }
+
+    //values[k]是第k个变量的取值；不含变量的表达式可以不传
+    int evaluate(const int* values=nullptr) const{
+        if (this->slots>0&&values==nullptr){
+            throw std::invalid_argument("Unbound variable in expression");
+        }
+        //线性表达式栈深不超过2，深树才退回到堆上的栈
+        int fixed[16]={};
+        std::vector<int> spill;
+        int* stack=fixed;
+        if (this->maxDepth>16){
+            spill.resize(this->maxDepth);
+            stack=spill.data();
+        }
+        int top=-1;
+        for (const Instruction& instruction: this->code) {
+            switch (instruction.code) {
+                case OpCode::Push:
+                    stack[++top]=instruction.operand;
+                    break;
+                case OpCode::Load:
+                    stack[++top]=values[instruction.operand];
+                    break;
+                case OpCode::Add:
+                    stack[top-1]=wrapAdd(stack[top-1], stack[top]);
+                    --top;
+                    break;
+                case OpCode::Multiply:
+                    stack[top-1]=wrapMultiply(stack[top-1], stack[top]);
+                    --top;
+                    break;
+                case OpCode::Raise:
+                    throw std::runtime_error("OperationExpression does not support interpretation");
+            }
+        }
+        return stack[0];
+    }
+
+    int evaluate(const Context& context) const{
+        return evaluate(context.data());
+    }
+
+    //列式批量求值：columns[k]是第k个变量的一整列，共rows行。按块处理，每条指令一次算完一块里的所有行，
+    //+和*走上面的列内核；结果与逐行evaluate相同（补码回绕），写入out。
+    //overflowed不为空时，overflowed[r]非0表示第r行有中间结果溢出了int；返回溢出的行数
+    size_t evaluateColumns(const int* const* columns, size_t columnCount, size_t rows,
+                           int* out, unsigned char* overflowed=nullptr) const{
+        //默认构造或clear()之后的空程序没有结果可取，下面的stack[0]会越界
+        if (this->code.empty()){
+            throw std::logic_error("Empty program");
+        }
+        if (columnCount<this->slots){
+            throw std::invalid_argument("Unbound variable in expression");
+        }
+        //字节码没有分支，Raise总会被执行到，与行的取值无关，可以先检查
+        for (const Instruction& instruction: this->code) {
+            if (instruction.code==OpCode::Raise){
+                throw std::runtime_error("OperationExpression does not support interpretation");
+            }
+        }
+        static constexpr size_t blockRows=256;
+        //每层栈一块缓冲；栈里存指针，Load直接指向列数据，不拷贝
+        std::vector<int> buffers(this->maxDepth*blockRows);
+        std::vector<const int*> stack(this->maxDepth);
+        int overflow[blockRows];
+        size_t overflowRows=0;
+        for (size_t base=0; base<rows; base+=blockRows) {
+            size_t n=std::min(blockRows, rows-base);
+            std::fill(overflow, overflow+n, 0);
+            int top=-1;
+            for (const Instruction& instruction: this->code) {
+                switch (instruction.code) {
+                    case OpCode::Push: {
+                        int* buffer=&buffers[(++top)*blockRows];
+                        std::fill(buffer, buffer+n, instruction.operand);
+                        stack[top]=buffer;
+                        break;
+                    }
+                    case OpCode::Load:
+                        stack[++top]=columns[instruction.operand]+base;
+                        break;
+                    case OpCode::Add:
+                    case OpCode::Multiply: {
+                        int* destination=&buffers[(top-1)*blockRows];
+                        if (instruction.code==OpCode::Add){
+                            addColumns(stack[top-1], stack[top], destination, overflow, n);
+                        } else{
+                            multiplyColumns(stack[top-1], stack[top], destination, overflow, n);
+                        }
+                        stack[--top]=destination;
+                        break;
+                    }
+                    case OpCode::Raise:
+                        break;
+                }
+            }
+            std::copy(stack[0], stack[0]+n, out+base);
+            for (size_t r=0; r<n; ++r) {
+                overflowRows+=overflow[r]!=0;
+                if (overflowed!=nullptr){
+                    overflowed[base+r]=overflow[r]!=0;
+                }
+            }
+        }
+        return overflowRows;
+    }
+};
+
 //抽象表达式类
 class Expression{
 public:
     virtual int interpret()=0;
+    //AST作为前端：把自己按后缀顺序编译成字节码
+    virtual void compile(CompiledExpression& out) const=0;
     virtual ~Expression()=default;
 };
 
@@ -34,6 +334,27 @@ public:
     int interpret() override{
         return this->value;
     }
+
+    void compile(CompiledExpression& out) const override{
+        out.emitPush(this->value);
+    }
+};
+
+//终结符表达式--变量，取值来自上下文
+class VariableExpression:public Expression{
+private:
+    const Context& context;
+    size_t slot;
+public:
+    VariableExpression(const Context& context, size_t slot):context(context),slot(slot){}
+
+    int interpret() override{
+        return this->context.get(this->slot);
+    }
+
+    void compile(CompiledExpression& out) const override{
+        out.emitLoad(this->slot);
+    }
 };
 
 //非终结符表达式类--运算符号类（又分加法和乘法）
@@ -44,8 +365,23 @@ private:
 public:
     explicit  AddExpression(Expression* l, Expression* r):left(l),right(r){}
 
+    //非终结符表达式拥有左右子树，随自己一起释放
+    AddExpression(const AddExpression&)=delete;
+    AddExpression& operator=(const AddExpression&)=delete;
+
+    ~AddExpression() override{
+        delete this->left;
+        delete this->right;
+    }
+
     int interpret() override{
-        return this->left->interpret()+this->right->interpret();
+        return wrapAdd(this->left->interpret(), this->right->interpret());
+    }
+
+    void compile(CompiledExpression& out) const override{
+        this->left->compile(out);
+        this->right->compile(out);
+        out.emitBinary(OpCode::Add);
     }
 };
 
@@ -57,8 +393,23 @@ private:
 public:
     explicit  MultiplyExpression(Expression* l, Expression* r):left(l),right(r){}
 
+    //非终结符表达式拥有左右子树，随自己一起释放
+    MultiplyExpression(const MultiplyExpression&)=delete;
+    MultiplyExpression& operator=(const MultiplyExpression&)=delete;
+
+    ~MultiplyExpression() override{
+        delete this->left;
+        delete this->right;
+    }
+
     int interpret() override{
-        return this->left->interpret()* this->right->interpret();
+        return wrapMultiply(this->left->interpret(), this->right->interpret());
+    }
+
+    void compile(CompiledExpression& out) const override{
+        this->left->compile(out);
+        this->right->compile(out);
+        out.emitBinary(OpCode::Multiply);
     }
 };
 
@@ -73,67 +424,636 @@ public:
         throw std::runtime_error("OperationExpression does not support interpretation");
     }
 
+    void compile(CompiledExpression& out) const override{
+        out.emitRaise();
+    }
+
     std::string getOperator() const{
         return this->oper;
     }
 };
 
-//解析表达式字符串
-int parseExpression(const std::string& expressionStr){
-    //istringstream:获取当前输入字符串流，并自动根据空格分割出各个非空格字符串元素
-    std::istringstream iss(expressionStr);
-    
-    //istream_iterator:迭代器类，对分出的非空格元素使用迭代器遍历访问，将其装入vector<string>容器中
-    std::vector<std::string> elements(std::istream_iterator<std::string>{iss},
-                                      std::istream_iterator<std::string>());
+//词法单元：运算符记录'+'或'*'，数字记录数值，变量记录它在上下文中的槽位
+enum class TokenKind:unsigned char{
+    Number,
+    Operator,
+    Variable
+};
+
+struct Token{
+    TokenKind kind;
+    char op;
+    int value;
+};
+
+//单遍手写分词：按空白切分（与istream>>string相同的空白集合），数字串边扫描边转换，
+//不再为每个元素构造regex和string；报错的内容与顺序和原先的regex+stoi完全一致
+class ExpressionTokenizer{
+public:
+    //'\t' '\n' '\v' '\f' '\r'是连续的9~13
+    static bool isSpace(char c){
+        return c==' '||(c>='\t'&&c<='\r');
+    }
+
+    //去掉首尾空白、把连续空白压成一个空格；分词只按空白切分，所以规范化前后分出的单元完全相同
+    //多数行本来就是规范的，这时直接返回text的视图，不做拷贝；否则写进buffer并返回它的视图
+    static std::string_view normalize(const std::string& text, std::string& buffer){
+        const char* p=text.data();
+        const char* end=p+text.size();
+        //空格在表达式里很密集且位置不规则，逐字符分支会频繁预测失败，这里用位运算累计
+        unsigned bad=!text.empty()&&(isSpace(*p)|isSpace(end[-1]));
+        size_t i=0;
+#if defined(__SSE2__)
+        //一次检查16个字符：控制类空白(9~13)，或空格后面紧跟任意空白
+        const __m128i below=_mm_set1_epi8('\t'-1);
+        const __m128i above=_mm_set1_epi8('\r'+1);
+        const __m128i space=_mm_set1_epi8(' ');
+        __m128i badBytes=_mm_setzero_si128();
+        for (; i+17<=text.size(); i+=16) {
+            __m128i current=_mm_loadu_si128(reinterpret_cast<const __m128i*>(p+i));
+            __m128i next=_mm_loadu_si128(reinterpret_cast<const __m128i*>(p+i+1));
+            __m128i currentControl=_mm_and_si128(_mm_cmpgt_epi8(current, below), _mm_cmplt_epi8(current, above));
+            __m128i nextControl=_mm_and_si128(_mm_cmpgt_epi8(next, below), _mm_cmplt_epi8(next, above));
+            __m128i nextSpace=_mm_or_si128(_mm_cmpeq_epi8(next, space), nextControl);
+            badBytes=_mm_or_si128(badBytes, currentControl);
+            badBytes=_mm_or_si128(badBytes, _mm_and_si128(_mm_cmpeq_epi8(current, space), nextSpace));
+        }
+        bad|=_mm_movemask_epi8(badBytes)!=0;
+#endif
+        for (; i+1<text.size(); ++i) {
+            auto c=static_cast<unsigned char>(p[i]);
+            auto next=static_cast<unsigned char>(p[i+1]);
+            bad|=static_cast<unsigned char>(c-'\t')<5u;
+            bad|=(c==' ')&((next==' ')|(static_cast<unsigned char>(next-'\t')<5u));
+        }
+        if (!bad){
+            return std::string_view(text);
+        }
+        buffer.clear();
+        while (p<end){
+            while (p<end&&isSpace(*p)){
+                ++p;
+            }
+            const char* begin=p;
+            while (p<end&&!isSpace(*p)){
+                ++p;
+            }
+            if (p>begin){
+                if (!buffer.empty()){
+                    buffer.push_back(' ');
+                }
+                buffer.append(begin, p);
+            }
+        }
+        return std::string_view(buffer);
+    }
+
+    //context不为空时，其中声明过的名字被识别为变量
+    static void tokenize(const std::string& text, std::vector<Token>& tokens, const Context* context=nullptr){
+        tokens.clear();
+        const char* p=text.data();
+        const char* end=p+text.size();
+        while (p<end){
+            if (isSpace(*p)){
+                ++p;
+                continue;
+            }
+            const char* begin=p;
+            bool digits=true;
+            long long value=0;
+            for (; p<end&&!isSpace(*p); ++p) {
+                if (*p>='0'&&*p<='9'){
+                    //超过int范围就不再累加，只记住溢出
+                    if (value<=INT32_MAX){
+                        value=value*10+(*p-'0');
+                    }
+                } else{
+                    digits=false;
+                }
+            }
+            size_t length=p-begin;
+            if (digits){
+                if (value>INT32_MAX){
+                    //std::stoi越界时抛出的正是out_of_range("stoi")
+                    throw std::out_of_range("stoi");
+                }
+                tokens.push_back(Token{TokenKind::Number, 0, static_cast<int>(value)});
+            } else if(length==1&&(*begin=='+'||*begin=='*')){
+                tokens.push_back(Token{TokenKind::Operator, *begin, 0});
+            } else if(int slot=context!=nullptr?context->find(std::string_view(begin, length)):-1; slot>=0){
+                tokens.push_back(Token{TokenKind::Variable, 0, slot});
+            } else{
+                throw std::invalid_argument("Invalid element in expression: "+std::string(begin, length));
+            }
+        }
+    }
+};
+
+//原先的归约过程在栈不足三个元素时对空栈取top，属于未定义行为（实际会崩溃），这里改为报错
+static const char* const malformedExpression="Malformed expression";
+
+//不经过AST直接把一行编译成字节码
+//原先的归约每次从栈顶取 右操作数、运算符、左操作数 三个元素，左操作数总是一个词法单元，
+//所以整棵树是向右延伸的一条链：从最右的单元出发，向左两个两个地合并；
+//运算符位置上是数字时，这三个元素被丢弃（不参与求值），从再左边一个单元重新开始
+class ExpressionCompiler{
+private:
+    std::vector<Token> tokens;
+
+    static void emitLeaf(const Token& token, CompiledExpression& out){
+        switch (token.kind) {
+            case TokenKind::Number:
+                out.emitPush(token.value);
+                break;
+            case TokenKind::Variable:
+                out.emitLoad(token.value);
+                break;
+            case TokenKind::Operator:
+                out.emitRaise();
+                break;
+        }
+    }
+
+public:
+    //out会被清空后重新填充；分词缓冲与out的缓冲在多次调用间复用
+    void compile(const std::string& text, CompiledExpression& out, const Context* context=nullptr){
+        ExpressionTokenizer::tokenize(text, this->tokens, context);
+        out.clear();
+        size_t n=this->tokens.size();
+        if (n==0){
+            throw std::invalid_argument(malformedExpression);
+        }
+        emitLeaf(this->tokens[n-1], out);
+        //p是当前累积结果在原栈中的位置，栈里剩p+1个元素
+        size_t p=n-1;
+        while (p>=1){
+            if (p<2){
+                throw std::invalid_argument(malformedExpression);
+            }
+            const Token& op=this->tokens[p-1];
+            if (op.kind==TokenKind::Operator){
+                emitLeaf(this->tokens[p-2], out);
+                out.emitBinary(op.op=='+'?OpCode::Add:OpCode::Multiply);
+                p-=2;
+            } else{
+                if (p<3){
+                    throw std::invalid_argument(malformedExpression);
+                }
+                out.clear();
+                emitLeaf(this->tokens[p-3], out);
+                p-=3;
+            }
+        }
+    }
+};
+
+//紧凑的AST节点：子节点用arena中的下标相连而不是指针，12字节
+enum class NodeKind:unsigned char{
+    Number,
+    Add,
+    Multiply,
+    //运算符被当作操作数，解释到它时报错
+    Operator,
+    //value是上下文中的槽位
+    Variable
+};
+
+struct AstNode{
+    NodeKind kind;
+    union{
+        int value;
+        uint32_t left;
+    };
+    uint32_t right;
+};
+
+static_assert(sizeof(AstNode)==12, "AstNode should stay compact");
+
+//按次解析用的单调arena：节点只追加、从不单独释放，reset一次丢弃上一次解析的全部节点（包括归约时被丢弃的），
+//vector容量保留下来，复用同一个arena解析时稳态下不再分配内存
+class ExpressionArena{
+private:
+    std::vector<AstNode> nodes;
+    std::vector<uint32_t> stack;
+    std::vector<Token> tokens;
+    //解释Variable节点时从这里取值，由parse记下
+    const Context* context=nullptr;
+
+    uint32_t add(NodeKind kind, int value, uint32_t right){
+        AstNode node;
+        node.kind=kind;
+        node.value=value;
+        node.right=right;
+        this->nodes.push_back(node);
+        return static_cast<uint32_t>(this->nodes.size()-1);
+    }
+
+    uint32_t addBinary(NodeKind kind, uint32_t left, uint32_t right){
+        AstNode node;
+        node.kind=kind;
+        node.left=left;
+        node.right=right;
+        this->nodes.push_back(node);
+        return static_cast<uint32_t>(this->nodes.size()-1);
+    }
+
+public:
+    void reset(){
+        this->nodes.clear();
+    }
+
+    //与buildExpression相同的栈归约，返回根节点下标；会先reset。
+    //带变量时context须在interpret期间保持有效，改变其中的取值后可以重复interpret同一棵树
+    uint32_t parse(const std::string& text, const Context* context=nullptr){
+        reset();
+        this->context=context;
+        ExpressionTokenizer::tokenize(text, this->tokens, context);
+        this->stack.clear();
+        for (const auto& token: this->tokens) {
+            switch (token.kind) {
+                case TokenKind::Number:
+                    this->stack.push_back(add(NodeKind::Number, token.value, 0));
+                    break;
+                case TokenKind::Variable:
+                    this->stack.push_back(add(NodeKind::Variable, token.value, 0));
+                    break;
+                case TokenKind::Operator:
+                    this->stack.push_back(add(NodeKind::Operator, token.op, 0));
+                    break;
+            }
+        }
+        if (this->stack.empty()){
+            throw std::invalid_argument(malformedExpression);
+        }
+        while (this->stack.size()>1){
+            size_t n=this->stack.size();
+            if (n<3){
+                throw std::invalid_argument(malformedExpression);
+            }
+            uint32_t right=this->stack[n-1];
+            const AstNode& op=this->nodes[this->stack[n-2]];
+            uint32_t left=this->stack[n-3];
+            this->stack.resize(n-3);
+            if (op.kind==NodeKind::Operator){
+                this->stack.push_back(addBinary(op.value=='+'?NodeKind::Add:NodeKind::Multiply, left, right));
+            } else if(this->stack.empty()){
+                throw std::invalid_argument(malformedExpression);
+            }
+        }
+        return this->stack.back();
+    }
+
+    int interpret(uint32_t index) const{
+        const AstNode& node=this->nodes[index];
+        switch (node.kind) {
+            case NodeKind::Number:
+                return node.value;
+            case NodeKind::Variable:
+                return this->context->get(node.value);
+            case NodeKind::Add:
+                return wrapAdd(interpret(node.left), interpret(node.right));
+            case NodeKind::Multiply:
+                return wrapMultiply(interpret(node.left), interpret(node.right));
+            case NodeKind::Operator:
+                break;
+        }
+        throw std::runtime_error("OperationExpression does not support interpretation");
+    }
+
+    void compile(uint32_t index, CompiledExpression& out) const{
+        const AstNode& node=this->nodes[index];
+        switch (node.kind) {
+            case NodeKind::Number:
+                out.emitPush(node.value);
+                break;
+            case NodeKind::Variable:
+                out.emitLoad(node.value);
+                break;
+            case NodeKind::Add:
+            case NodeKind::Multiply:
+                compile(node.left, out);
+                compile(node.right, out);
+                out.emitBinary(node.kind==NodeKind::Add?OpCode::Add:OpCode::Multiply);
+                break;
+            case NodeKind::Operator:
+                out.emitRaise();
+                break;
+        }
+    }
+
+    size_t size() const{
+        return this->nodes.size();
+    }
+};
+
+//AST前端：按原先的栈归约构建指针相连的表达式树，调用者负责释放返回的根节点；
+//归约中用掉的运算符节点和被丢弃的三元组当场释放，出错时释放栈里剩下的节点。
+//带变量时树里的VariableExpression引用context，context须比树活得久
+Expression* buildExpression(const std::string& expressionStr, const Context* context=nullptr){
+    std::vector<Token> tokens;
+    ExpressionTokenizer::tokenize(expressionStr, tokens, context);
     std::stack<Expression*> st;
-    for (const auto& element: elements) {
-        if (std::regex_match(element, std::regex("\\d+"))){
-            //regex():正则表达式构造函数；regex_match(str,匹配规则)
-            st.push(new NumberExpression(std::stoi(element)));//stoi(str)字符串转int型函数
-        } else if(element=="+"||element=="*"){
-            st.push(new OperatorExpression(element));
-        } else {
-            throw std::invalid_argument("Invalid element in expression: "+ element);
-        }
-    }
-    while(st.size()>1){
-        Expression* right = st.top();
-        st.pop();
-        Expression* operatorExp = st.top();
-        st.pop();
-        Expression* left = st.top();
-        st.pop();
-        if (auto* opExp=dynamic_cast<OperatorExpression*>(operatorExp)){
-            std::string op = opExp->getOperator();
-            if (op=="+"){
-                st.push(new AddExpression(left, right));
-            }else if(op=="*"){
-                st.push(new MultiplyExpression(left, right));
+    try {
+        for (const auto& token: tokens) {
+            switch (token.kind) {
+                case TokenKind::Number:
+                    st.push(new NumberExpression(token.value));
+                    break;
+                case TokenKind::Variable:
+                    st.push(new VariableExpression(*context, token.value));
+                    break;
+                case TokenKind::Operator:
+                    st.push(new OperatorExpression(std::string(1, token.op)));
+                    break;
+            }
+        }
+        if (st.empty()){
+            throw std::invalid_argument(malformedExpression);
+        }
+        while(st.size()>1){
+            if (st.size()<3){
+                throw std::invalid_argument(malformedExpression);
+            }
+            Expression* right = st.top();
+            st.pop();
+            Expression* operatorExp = st.top();
+            st.pop();
+            Expression* left = st.top();
+            st.pop();
+            if (auto* opExp=dynamic_cast<OperatorExpression*>(operatorExp)){
+                std::string op = opExp->getOperator();
+                delete operatorExp;
+                if (op=="+"){
+                    st.push(new AddExpression(left, right));
+                }else{
+                    st.push(new MultiplyExpression(left, right));
+                }
             } else{
-                throw std::invalid_argument("Invalid operator type in expression");
+                delete right;
+                delete operatorExp;
+                delete left;
+                if(st.empty()){
+                    throw std::invalid_argument(malformedExpression);
+                }
             }
         }
+    } catch (...){
+        while (!st.empty()){
+            delete st.top();
+            st.pop();
+        }
+        throw;
     }
-    int result = st.top()->interpret();
-    delete st.top();
+    return st.top();
+}
+
+//解析表达式字符串并解释求值，节点分配在arena里；反复解析时传入同一个arena以复用内存
+int parseExpression(const std::string& expressionStr, ExpressionArena& arena){
+    uint32_t root=arena.parse(expressionStr);
+    int result=arena.interpret(root);
+    arena.reset();
     return result;
 }
 
+int parseExpression(const std::string& expressionStr){
+    ExpressionArena arena;
+    return parseExpression(expressionStr, arena);
+}
+
+//编译结果的LRU缓存：以规范化后的表达式文本为键，空白不同的等价写法共享一项；
+//编译出错的文本也缓存其异常，命中时原样重新抛出。按估算的内存占用淘汰最久未用的项。
+//条目放在一个vector里，LRU链表和哈希表都用下标相连，命中时不再经过链表节点和哈希节点层层跳转
+class ExpressionCache{
+private:
+    static constexpr uint32_t none=UINT32_MAX;
+
+    struct Entry{
+        std::string key;
+        CompiledExpression program;
+        std::exception_ptr error;
+        size_t bytes=0;
+        uint32_t hash=0;
+        //LRU双向链表；空闲条目用next串成空闲链
+        uint32_t prev=none;
+        uint32_t next=none;
+    };
+
+    //线性探测哈希表的槽：键的哈希值加条目下标，哈希相等才去比较键文本
+    struct Slot{
+        uint32_t hash;
+        uint32_t entry;
+    };
+
+    size_t byteBudget;
+    size_t bytes=0;
+    std::vector<Entry> entries;
+    uint32_t freeEntries=none;
+    uint32_t head=none;
+    uint32_t tail=none;
+    size_t count=0;
+    //容量是2的幂，装载率不超过1/2
+    std::vector<Slot> slots;
+    ExpressionCompiler compiler;
+    CompiledExpression scratch;
+    std::string normalized;
+    size_t hitCount=0;
+    size_t missCount=0;
+    size_t evictionCount=0;
+
+    size_t mask() const{
+        return this->slots.size()-1;
+    }
+
+    void unlink(uint32_t index){
+        Entry& entry=this->entries[index];
+        if (entry.prev!=none){
+            this->entries[entry.prev].next=entry.next;
+        } else{
+            this->head=entry.next;
+        }
+        if (entry.next!=none){
+            this->entries[entry.next].prev=entry.prev;
+        } else{
+            this->tail=entry.prev;
+        }
+    }
+
+    void pushFront(uint32_t index){
+        Entry& entry=this->entries[index];
+        entry.prev=none;
+        entry.next=this->head;
+        if (this->head!=none){
+            this->entries[this->head].prev=index;
+        } else{
+            this->tail=index;
+        }
+        this->head=index;
+    }
+
+    void insertSlot(uint32_t hash, uint32_t index){
+        size_t i=hash&mask();
+        while (this->slots[i].entry!=none){
+            i=(i+1)&mask();
+        }
+        this->slots[i]=Slot{hash, index};
+    }
+
+    void grow(){
+        std::vector<Slot> old(std::max<size_t>(16, this->slots.size()*2), Slot{0, none});
+        old.swap(this->slots);
+        for (const Slot& slot: old) {
+            if (slot.entry!=none){
+                insertSlot(slot.hash, slot.entry);
+            }
+        }
+    }
+
+    //删除槽位后把同一探测链上后面的元素往回挪，不留墓碑
+    void eraseSlot(uint32_t hash, uint32_t index){
+        size_t i=hash&mask();
+        while (this->slots[i].entry!=index){
+            i=(i+1)&mask();
+        }
+        size_t j=i;
+        for (;;){
+            j=(j+1)&mask();
+            if (this->slots[j].entry==none){
+                break;
+            }
+            size_t home=this->slots[j].hash&mask();
+            //home不在(i, j]之间时，j上的元素可以挪到i
+            bool between=i<j?(home>i&&home<=j):(home>i||home<=j);
+            if (!between){
+                this->slots[i]=this->slots[j];
+                i=j;
+            }
+        }
+        this->slots[i].entry=none;
+    }
+
+    void evict(){
+        //至少保留刚插入的一项，即使它本身就超过预算
+        while (this->bytes>this->byteBudget&&this->count>1){
+            uint32_t victim=this->tail;
+            Entry& entry=this->entries[victim];
+            eraseSlot(entry.hash, victim);
+            unlink(victim);
+            this->bytes-=entry.bytes;
+            std::string().swap(entry.key);
+            entry.program=CompiledExpression();
+            entry.error=nullptr;
+            entry.next=this->freeEntries;
+            this->freeEntries=victim;
+            --this->count;
+            ++this->evictionCount;
+        }
+    }
+
+    uint32_t allocateEntry(){
+        if (this->freeEntries!=none){
+            uint32_t index=this->freeEntries;
+            this->freeEntries=this->entries[index].next;
+            return index;
+        }
+        this->entries.emplace_back();
+        return static_cast<uint32_t>(this->entries.size()-1);
+    }
+
+public:
+    explicit ExpressionCache(size_t byteBudget=16u<<20):byteBudget(byteBudget){}
+
+    ExpressionCache(const ExpressionCache&)=delete;
+    ExpressionCache& operator=(const ExpressionCache&)=delete;
+
+    //返回text的编译结果；引用在下一次lookup之前有效
+    const CompiledExpression& lookup(const std::string& text){
+        std::string_view key=ExpressionTokenizer::normalize(text, this->normalized);
+        auto hash=static_cast<uint32_t>(std::hash<std::string_view>()(key));
+        if ((this->count+1)*2>this->slots.size()){
+            grow();
+        }
+        uint32_t index=none;
+        for (size_t i=hash&mask(); this->slots[i].entry!=none; i=(i+1)&mask()) {
+            if (this->slots[i].hash==hash&&this->entries[this->slots[i].entry].key==key){
+                index=this->slots[i].entry;
+                break;
+            }
+        }
+        if (index!=none){
+            ++this->hitCount;
+            if (index!=this->head){
+                unlink(index);
+                pushFront(index);
+            }
+        } else{
+            ++this->missCount;
+            index=allocateEntry();
+            Entry& entry=this->entries[index];
+            entry.key.assign(key.data(), key.size());
+            entry.hash=hash;
+            entry.bytes=0;
+            try {
+                this->compiler.compile(entry.key, this->scratch);
+                entry.program=this->scratch;
+            } catch (const std::exception& e){
+                entry.error=std::current_exception();
+                entry.bytes=std::char_traits<char>::length(e.what());
+            }
+            //条目本身、两个哈希槽（装载率1/2）、键和指令缓冲
+            entry.bytes+=sizeof(Entry)+2*sizeof(Slot)+entry.key.capacity()+
+                         entry.program.memoryBytes()-sizeof(CompiledExpression);
+            insertSlot(hash, index);
+            pushFront(index);
+            ++this->count;
+            this->bytes+=entry.bytes;
+            evict();
+        }
+        const Entry& entry=this->entries[index];
+        if (entry.error){
+            std::rethrow_exception(entry.error);
+        }
+        return entry.program;
+    }
+
+    size_t hits() const{
+        return this->hitCount;
+    }
+
+    size_t misses() const{
+        return this->missCount;
+    }
+
+    size_t evictions() const{
+        return this->evictionCount;
+    }
+
+    size_t memoryBytes() const{
+        return this->bytes;
+    }
+
+    size_t size() const{
+        return this->count;
+    }
+};
+
 int main(){
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(nullptr);
     std::vector<std::string> inputLines;
     std::string line;
     //getline(cin, line):获取cin中一行的输入
     while (std::getline(std::cin, line)&&!line.empty()){
         inputLines.emplace_back(line);
     }
+    //同一表达式反复出现时直接复用编译结果
+    ExpressionCache cache;
     for (const auto & inputLine : inputLines){
         try {
-            int result= parseExpression(inputLine);
-            std::cout<<result<<std::endl;
+            int result= cache.lookup(inputLine).evaluate();
+            std::cout<<result<<'\n';
         }catch (const std::exception& e){
             //捕获try中抛出的错误，并将其打印
-            std::cout<<"Error-"<<e.what()<<std::endl;
+            std::cout<<"Error-"<<e.what()<<'\n';
         }
     }
     return 0;
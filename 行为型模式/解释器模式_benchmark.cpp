@@ -0,0 +1,414 @@
+/* 解释器模式的基准测试。
+ * bytecode：1e6行随机表达式（1到8个0~100的数，以+和*相连，约1%的行带非法元素），逐行求值的吞吐，
+ *   对比原来的前端（istringstream切分、每个元素构造一次regex匹配、stoi、每个节点new）、
+ *   新分词器+指针AST解释、新分词器直接编译成字节码再求值三种做法，并核对三者的结果之和与出错行数相同。
+ * arena：同一批表达式的解析+求值耗时与每行分配次数，对比原来的前端（只取前2e4行，太慢）、指针AST逐行new/delete、
+ *   每次调用新建ExpressionArena、反复复用同一个ExpressionArena；再用复用的arena连续解析给定行数（默认1e7），
+ *   报告RSS增长与尚未释放的分配数，确认长时间运行不泄漏。
+ * cache：从1e5条不同的表达式（1到30个0~999的数）中按Zipf分布（s=0.9与1.1）抽取给定次数（默认2e6）的查询，
+ *   其中30%的行把空格换成随机的制表符或多个空格。对比每次都编译再求值与1MB、4MB、64MB预算的ExpressionCache，
+ *   报告命中率、条目数、缓存估算的内存、RSS增长与吞吐，并核对结果之和。
+ * columnar：两个变量x、y各给定行数（默认1e6）的随机值，几条表达式逐行求值的吞吐（百万行/秒），对比指针AST
+ *   （每行Context::set后interpret）、ExpressionArena、逐行执行字节码与CompiledExpression::evaluateColumns，各取7轮中的最好成绩，
+ *   并核对按列求值的结果与逐行的结果一致。按列求值是否走SSE2由编译选项决定（-mno-sse2时为逐行标量循环）。
+ * 编译：g++ -std=c++17 -O2 解释器模式_benchmark.cpp
+ * 用法：解释器模式_benchmark bytecode [行数，默认1e6]
+ *       解释器模式_benchmark arena [总行数，默认1e7]
+ *       解释器模式_benchmark cache [查询次数，默认2e6]
+ *       解释器模式_benchmark columnar [行数，默认1e6]
+ */
+//复用模式程序中的类，程序自己的main改名后不使用
+#define main interpreterProgramMain
+#include "解释器模式.cpp"
+#undef main
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <regex>
+#include <sstream>
+
+using BenchClock=std::chrono::steady_clock;
+
+//统计全局operator new的调用次数与尚未释放的分配数，基准是单线程的，用普通计数即可。
+//new与delete都不内联：内联到标准容器里后，GCC会把malloc/free与new/delete误判为不配对并告警
+static unsigned long long allocations=0;
+static long long liveAllocations=0;
+
+__attribute__((noinline)) void* operator new(size_t size){
+    ++allocations;
+    ++liveAllocations;
+    if (void* p=std::malloc(size==0?1:size)){
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept{
+    if (p!=nullptr){
+        --liveAllocations;
+    }
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept{
+    operator delete(p);
+}
+
+long residentKilobytes(){
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)){
+        if (line.rfind("VmRSS:", 0)==0){
+            return std::atol(line.c_str()+6);
+        }
+    }
+    return 0;
+}
+
+double secondsSince(BenchClock::time_point start){
+    return std::chrono::duration<double>(BenchClock::now()-start).count();
+}
+
+//与原来的输入相同的形状：数和运算符以单个空格分隔
+std::vector<std::string> generateLines(size_t count, unsigned seed){
+    std::mt19937 rng(seed);
+    std::vector<std::string> lines;
+    lines.reserve(count);
+    for (size_t i=0; i<count; ++i) {
+        int operands=1+static_cast<int>(rng()%8);
+        std::string line=std::to_string(rng()%101);
+        for (int k=1; k<operands; ++k) {
+            line+=rng()%2==0?" + ":" * ";
+            line+=std::to_string(rng()%101);
+        }
+        if (rng()%100==0){
+            line+=" x";
+        }
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+//原来的前端：istringstream按空白切分，每个元素构造一个regex判断是否为数字，再按同样的栈归约建树求值。
+//原来出错或丢弃三元组时会泄漏节点，这里补上释放，只保留它的分词与分配开销
+int legacyParseExpression(const std::string& expressionStr){
+    std::istringstream iss(expressionStr);
+    std::vector<std::string> elements(std::istream_iterator<std::string>{iss},
+                                      std::istream_iterator<std::string>());
+    std::stack<Expression*> st;
+    auto release=[&st]{
+        while (!st.empty()){
+            delete st.top();
+            st.pop();
+        }
+    };
+    for (const auto& element: elements) {
+        if (std::regex_match(element, std::regex("\\d+"))){
+            st.push(new NumberExpression(std::stoi(element)));
+        } else if(element=="+"||element=="*"){
+            st.push(new OperatorExpression(element));
+        } else {
+            release();
+            throw std::invalid_argument("Invalid element in expression: "+ element);
+        }
+    }
+    while (st.size()>=3){
+        Expression* right = st.top();
+        st.pop();
+        Expression* operatorExp = st.top();
+        st.pop();
+        Expression* left = st.top();
+        st.pop();
+        if (auto* opExp=dynamic_cast<OperatorExpression*>(operatorExp)){
+            bool add=opExp->getOperator()=="+";
+            delete operatorExp;
+            st.push(add?static_cast<Expression*>(new AddExpression(left, right)):new MultiplyExpression(left, right));
+        } else{
+            delete right;
+            delete operatorExp;
+            delete left;
+        }
+    }
+    if (st.size()!=1){
+        release();
+        throw std::invalid_argument(malformedExpression);
+    }
+    int result=st.top()->interpret();
+    release();
+    return result;
+}
+
+//逐行求值，出错的行计数后跳过
+template<typename Evaluate>
+void measureLines(const char* name, const std::vector<std::string>& lines, Evaluate evaluate){
+    long long sum=0;
+    size_t errors=0;
+    auto start=BenchClock::now();
+    for (const auto& line: lines) {
+        try {
+            sum+=evaluate(line);
+        }catch (const std::exception&){
+            ++errors;
+        }
+    }
+    double seconds=secondsSince(start);
+    std::printf("%-36s %8.3f s  %11.0f lines/s  (sum %lld, errors %zu)\n", name, seconds, lines.size()/seconds, sum,
+                errors);
+}
+
+void benchmarkBytecode(size_t count){
+    std::vector<std::string> lines=generateLines(count, 5);
+    std::printf("%zu lines\n", count);
+    measureLines("regex + istringstream + new AST", lines, legacyParseExpression);
+    measureLines("tokenizer + pointer AST", lines, [](const std::string& line){
+        Expression* root=buildExpression(line);
+        int result=root->interpret();
+        delete root;
+        return result;
+    });
+    ExpressionCompiler compiler;
+    CompiledExpression program;
+    measureLines("tokenizer -> bytecode -> evaluate", lines, [&](const std::string& line){
+        compiler.compile(line, program);
+        return program.evaluate();
+    });
+}
+
+//解析+求值一批行，报告每行耗时与分配次数
+template<typename Evaluate>
+void measureParse(const char* name, const std::vector<std::string>& lines, size_t count, Evaluate evaluate){
+    long long sum=0;
+    unsigned long long allocationsBefore=allocations;
+    auto start=BenchClock::now();
+    for (size_t i=0; i<count; ++i) {
+        try {
+            sum+=evaluate(lines[i]);
+        }catch (const std::exception&){
+        }
+    }
+    double seconds=secondsSince(start);
+    std::printf("%-36s %8zu lines %9.1f ns/line  %6.2f allocs/line  (sum %lld)\n", name, count, seconds*1e9/count,
+                static_cast<double>(allocations-allocationsBefore)/count, sum);
+}
+
+void benchmarkArena(size_t total){
+    const size_t batch=1000000;
+    std::vector<std::string> lines=generateLines(batch, 5);
+    measureParse("regex + istringstream + new AST", lines, 20000, legacyParseExpression);
+    measureParse("regex-free tokenizer + pointer AST", lines, batch, [](const std::string& line){
+        Expression* root=buildExpression(line);
+        int result=root->interpret();
+        delete root;
+        return result;
+    });
+    measureParse("new ExpressionArena per line", lines, batch, [](const std::string& line){
+        return parseExpression(line);
+    });
+    ExpressionArena arena;
+    measureParse("reused ExpressionArena", lines, batch, [&](const std::string& line){
+        return parseExpression(line, arena);
+    });
+
+    //长时间运行：出错的行也走完整的抛出路径，节点仍由arena回收
+    long residentBefore=residentKilobytes();
+    long long liveBefore=liveAllocations;
+    long long sum=0;
+    size_t errors=0;
+    auto start=BenchClock::now();
+    for (size_t i=0; i<total; ++i) {
+        try {
+            sum+=parseExpression(lines[i%batch], arena);
+        }catch (const std::exception&){
+            ++errors;
+        }
+    }
+    double seconds=secondsSince(start);
+    std::printf("reused arena, %zu lines: %.2f s, %.1f ns/line, RSS growth %ld KB, live allocations %+lld "
+                "(sum %lld, errors %zu)\n", total, seconds, seconds*1e9/total, residentKilobytes()-residentBefore,
+                liveAllocations-liveBefore, sum, errors);
+}
+
+//按排名r的概率正比于1/r^s抽样，查询里的空白随机变化，缓存需要先规范化才能命中
+std::vector<std::string> zipfQueries(const std::vector<std::string>& distinct, double s, size_t count,
+                                     std::mt19937_64& rng){
+    std::vector<double> cumulative(distinct.size());
+    double total=0;
+    for (size_t rank=0; rank<distinct.size(); ++rank) {
+        total+=1.0/std::pow(static_cast<double>(rank+1), s);
+        cumulative[rank]=total;
+    }
+    std::uniform_real_distribution<double> uniform(0, total);
+    std::vector<std::string> queries;
+    queries.reserve(count);
+    for (size_t i=0; i<count; ++i) {
+        size_t rank=std::lower_bound(cumulative.begin(), cumulative.end(), uniform(rng))-cumulative.begin();
+        rank=std::min(rank, distinct.size()-1);
+        std::string query=distinct[rank];
+        if (rng()%10<3){
+            std::string spaced="  ";
+            for (char c: query) {
+                if (c==' '){
+                    spaced+=rng()%2?"\t":"   ";
+                } else{
+                    spaced+=c;
+                }
+            }
+            query=spaced+" ";
+        }
+        queries.push_back(std::move(query));
+    }
+    return queries;
+}
+
+void benchmarkCache(size_t count){
+    std::mt19937_64 rng(9);
+    std::vector<std::string> distinct;
+    for (int i=0; i<100000; ++i) {
+        int operands=1+static_cast<int>(rng()%30);
+        std::string line=std::to_string(rng()%1000);
+        for (int k=1; k<operands; ++k) {
+            line+=rng()%2?" + ":" * ";
+            line+=std::to_string(rng()%1000);
+        }
+        distinct.push_back(std::move(line));
+    }
+    for (double s: {0.9, 1.1}) {
+        std::vector<std::string> queries=zipfQueries(distinct, s, count, rng);
+        ExpressionCompiler compiler;
+        CompiledExpression program;
+        long long expected=0;
+        auto start=BenchClock::now();
+        for (const auto& query: queries) {
+            compiler.compile(query, program);
+            expected+=program.evaluate();
+        }
+        double uncached=secondsSince(start);
+        std::printf("zipf s=%.1f, %zu distinct, %zu queries: no cache %.2f M lines/s\n", s, distinct.size(), count,
+                    count/uncached/1e6);
+        for (size_t budget: {size_t{1}<<20, size_t{4}<<20, size_t{64}<<20}) {
+            long residentBefore=residentKilobytes();
+            long long sum=0;
+            ExpressionCache cache(budget);
+            start=BenchClock::now();
+            for (const auto& query: queries) {
+                sum+=cache.lookup(query).evaluate();
+            }
+            double seconds=secondsSince(start);
+            std::printf("  budget %5zu KB: hit %5.1f%%  entries %6zu  accounted %6.0f KB  RSS +%6ld KB  "
+                        "%.2f M lines/s (%.2fx)%s\n", budget>>10, 100.0*cache.hits()/count, cache.size(),
+                        cache.memoryBytes()/1024.0, residentKilobytes()-residentBefore, count/seconds/1e6,
+                        uncached/seconds, sum==expected?"":" (SUM MISMATCH)");
+        }
+    }
+}
+
+//单轮只有几毫秒，取多轮中的最好成绩，减少频率与调度抖动的影响
+template<typename Body>
+double bestSeconds(int repeats, Body body){
+    double best=0;
+    for (int r=0; r<repeats; ++r) {
+        auto start=BenchClock::now();
+        body();
+        double seconds=secondsSince(start);
+        if (r==0||seconds<best){
+            best=seconds;
+        }
+    }
+    return best;
+}
+
+const char* columnPath(){
+#if defined(__SSE2__)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void benchmarkColumnar(size_t rows){
+    Context context;
+    context.declare("x");
+    context.declare("y");
+    //右移随机位数，让数值大小分布较广，乘法既有不溢出的也有溢出的
+    std::mt19937 rng(42);
+    std::vector<int> xs(rows), ys(rows);
+    for (size_t i=0; i<rows; ++i) {
+        xs[i]=static_cast<int>(rng())>>(rng()%32);
+        ys[i]=static_cast<int>(rng())>>(rng()%32);
+    }
+    const int* columns[2]={xs.data(), ys.data()};
+    std::printf("%zu rows, evaluateColumns path: %s, M rows/s\n", rows, columnPath());
+    for (const char* text: {"x * 3 + y * x + 7", "x + y", "x * y", "1 + x * y + y * y * 3 + x"}) {
+        ExpressionCompiler compiler;
+        CompiledExpression program;
+        compiler.compile(text, program, &context);
+        std::unique_ptr<Expression> tree(buildExpression(text, &context));
+        ExpressionArena arena;
+        uint32_t root=arena.parse(text, &context);
+        long long sink=0;
+        double treeSeconds=bestSeconds(7, [&]{
+            for (size_t i=0; i<rows; ++i) {
+                context.set(0, xs[i]);
+                context.set(1, ys[i]);
+                sink+=tree->interpret();
+            }
+        });
+        double arenaSeconds=bestSeconds(7, [&]{
+            for (size_t i=0; i<rows; ++i) {
+                context.set(0, xs[i]);
+                context.set(1, ys[i]);
+                sink+=arena.interpret(root);
+            }
+        });
+        double rowSeconds=bestSeconds(7, [&]{
+            for (size_t i=0; i<rows; ++i) {
+                int values[2]={xs[i], ys[i]};
+                sink+=program.evaluate(values);
+            }
+        });
+        std::vector<int> out(rows);
+        std::vector<unsigned char> overflowed(rows);
+        size_t overflowRows=0;
+        double columnSeconds=bestSeconds(7, [&]{
+            overflowRows=program.evaluateColumns(columns, 2, rows, out.data(), overflowed.data());
+        });
+
+        size_t mismatches=0;
+        for (size_t i=0; i<rows; ++i) {
+            int values[2]={xs[i], ys[i]};
+            mismatches+=out[i]!=program.evaluate(values);
+        }
+        std::printf("%-28s tree %6.1f  arena %6.1f  bytecode %6.1f  columns %7.1f  (%zu overflow rows, %zu mismatches, "
+                    "sink %lld)\n", text, rows/treeSeconds/1e6, rows/arenaSeconds/1e6, rows/rowSeconds/1e6,
+                    rows/columnSeconds/1e6, overflowRows, mismatches, sink&1);
+    }
+}
+
+int main(int argc, char* argv[]){
+    std::string mode=argc>1?argv[1]:"";
+    long long count=argc>2?std::atoll(argv[2]):0;
+    if (mode=="bytecode"){
+        benchmarkBytecode(count>0?static_cast<size_t>(count):1000000);
+        return 0;
+    }
+    if (mode=="arena"){
+        benchmarkArena(count>0?static_cast<size_t>(count):10000000);
+        return 0;
+    }
+    if (mode=="cache"){
+        benchmarkCache(count>0?static_cast<size_t>(count):2000000);
+        return 0;
+    }
+    if (mode=="columnar"){
+        benchmarkColumnar(count>0?static_cast<size_t>(count):1000000);
+        return 0;
+    }
+    std::fprintf(stderr, "usage: 解释器模式_benchmark bytecode|arena|cache|columnar [count]\n");
+    return 2;
+}
@@ -67,11 +67,11 @@ class AreaCalculator:public Visitor{
 public:
     void visit(class Circle &circle) override{
         double area = 3.14*std::pow(circle.getRadius(),2);
-        std::cout<<area<<std::endl;
+        std::cout<<area<<'\n';
     }
     void visit(class Rectangle &rectangle) override{
         int area = rectangle.getHeight()*rectangle.getWidth();
-        std::cout<<area<<std::endl;
+        std::cout<<area<<'\n';
     }
 };
 
@@ -91,6 +91,8 @@ public:
 
 
 int main(){
+    std::ios::sync_with_stdio(false);
+    std::cin.tie(nullptr);
     int n;
     std::cin>>n;
     std::vector<Shape*> shapes;
@@ -106,7 +108,7 @@ int main(){
             std::cin>>width>>height;
             shapes.emplace_back(new Rectangle(width,height));
         }else{
-            std::cout<<"Invalid input"<<std::endl;
+            std::cout<<"Invalid input"<<'\n';
             return 1;
         }
     }
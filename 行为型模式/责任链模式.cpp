@@ -32,11 +32,11 @@ public:
     explicit Supervisor(Handler* nextHandler):nextHandler(nextHandler){}
     void request(const string& name, const int& days) override{
         if (days <= MAX_SUPERVISOR_HANDLE_DAYS) {
-            cout << name << " Approved by Supervisor." << endl;
+            cout << name << " Approved by Supervisor." << '\n';
         } else if (nextHandler != nullptr) {
             nextHandler->request(name, days);
         } else {
-            cout << name << " Denied by Supervisor." << endl;
+            cout << name << " Denied by Supervisor." << '\n';
         }
     }
     ~Supervisor() override =default;
@@ -50,11 +50,11 @@ public:
     explicit Manager(Handler* nextHandler):nextHandler(nextHandler){}
     void request(const string& name, const int& days) override{
         if (days <= MAX_MANAGER_HANDLE_DAYS) {
-            cout << name << " Approved by Manager." << endl;
+            cout << name << " Approved by Manager." << '\n';
         } else if (nextHandler != nullptr) {
             nextHandler->request(name, days);
         } else {
-            cout << name << " Denied by Manager." << endl;
+            cout << name << " Denied by Manager." << '\n';
         }
     }
     ~Manager() override =default;
@@ -66,9 +66,9 @@ private:
 public:
     void request(const string& name, const int& days) override{
         if (days <= MAX_DIRECTOR_HANDLE_DAYS) {
-            cout << name << " Approved by Director." << endl;
+            cout << name << " Approved by Director." << '\n';
         } else {
-            cout << name << " Denied by Director." << endl;
+            cout << name << " Denied by Director." << '\n';
         }
     }
     ~ Director() override =default;
@@ -91,6 +91,8 @@ public:
 
 
 int main() {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
     int quantity;
     cin >> quantity;
     Handler* director = new Director();
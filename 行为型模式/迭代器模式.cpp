@@ -58,6 +58,8 @@ public:
 
 
 int main() {
+    ios::sync_with_stdio(false);
+    cin.tie(nullptr);
     int N;
     cin>>N;
     ConcretStudentArrays studentArrays;
@@ -68,7 +70,7 @@ int main() {
     }
     for (auto i = studentArrays.begin(); i != studentArrays.end(); ++i) {
         const Student& stu=*i;
-        cout<<stu.getName()<<" "<<stu.getID()<<endl;
+        cout<<stu.getName()<<" "<<stu.getID()<<'\n';
     }
     return 0;
 }
\ No newline at end of file